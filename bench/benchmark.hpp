@@ -0,0 +1,246 @@
+#ifndef BASE_BENCH_BENCHMARK_HPP
+#define BASE_BENCH_BENCHMARK_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <regex>
+#include <string>
+#include <vector>
+#include "perf_counters.hpp"
+#include "report.hpp"
+
+// Microbenchmark runner. A case is a callable taking a `state&`, which does
+// its setup and then repeats the measured operation while
+// `state.keep_running()`:
+//
+//     runner.run("lookup/" + std::to_string(n), [&](bench::state& state) {
+//         std::size_t i = 0;
+//         while (state.keep_running()) bench::do_not_optimize(set.count(queries[i++ % n]));
+//     });
+//
+// The runner picks an iteration count that takes at least `--min-time`
+// seconds, runs `--warmup` untimed repetitions, then `--repetitions` timed
+// ones, and reports the median, mean, minimum and standard deviation of the
+// time per operation, with hardware counters where available (see
+// perf_counters.hpp). `--filter=REGEX` selects cases by name and
+// `--format=table|csv|json` picks the output (see report.hpp).
+
+namespace bench {
+
+// Forces `value` to be computed, as if it were read by the caller.
+template <typename T>
+inline void do_not_optimize(T const& value) noexcept {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Forces `value` to be computed and treated as modified afterwards.
+template <typename T>
+inline void do_not_optimize(T& value) noexcept {
+    asm volatile("" : "+m,r"(value) : : "memory");
+}
+
+// Forces pending writes to memory to be considered observable.
+inline void clobber_memory() noexcept {
+    asm volatile("" : : : "memory");
+}
+
+class state {
+public:
+    std::size_t iterations() const noexcept { return total; }
+
+    // Operations done by one iteration, for the per-operation figures.
+    void set_operations(std::size_t n) noexcept { operations = n; }
+
+    // Starts the clock on the first call; false once all iterations ran.
+    bool keep_running() noexcept {
+        if (remaining != 0) {
+            if (remaining-- == total) resume_timing();
+            return true;
+        }
+        pause_timing();
+        return false;
+    }
+
+    // For setup inside the loop that must not be measured.
+    void pause_timing() noexcept {
+        if (not running) return;
+        counters.stop();
+        elapsed += std::chrono::steady_clock::now() - start;
+        running = false;
+    }
+
+    void resume_timing() noexcept {
+        if (running) return;
+        running = true;
+        start = std::chrono::steady_clock::now();
+        counters.start();
+    }
+
+private:
+    friend class runner;
+
+    state(std::size_t iterations, perf_counters& counters) noexcept
+        : total(iterations), remaining(iterations), operations(1), running(false), elapsed(), start(),
+          counters(counters) {
+        counters.reset();
+    }
+
+    std::size_t total;
+    std::size_t remaining;
+    std::size_t operations;
+    bool running;
+    std::chrono::steady_clock::duration elapsed;
+    std::chrono::steady_clock::time_point start;
+    perf_counters& counters;
+};
+
+class runner {
+public:
+    // Parses the options described above; prints a usage message and exits
+    // on anything else.
+    runner(int argc, char** argv)
+        : filter(""), min_time(0.05), warmup(1), repetitions(3), output(parse(argc, argv)), counters() {
+        if (not counters.available()) {
+            std::fprintf(stderr, "hardware counters unavailable, reporting timings only\n");
+        }
+    }
+
+    bool selected(std::string const& name) const { return std::regex_search(name, filter); }
+
+    // Measures `body` and writes the result, unless the filter excludes it.
+    template <typename F>
+    void run(std::string const& name, F&& body) {
+        if (not selected(name)) return;
+
+        auto iterations = calibrate(name, body);
+        for (std::size_t i = 0; i != warmup; ++i) sample(name, body, iterations);
+
+        std::vector<double> times;
+        result r;
+        r.name = name;
+        r.iterations = iterations;
+        r.repetitions = repetitions;
+        for (std::size_t i = 0; i != counter_count; ++i) {
+            r.counters.available[i] = true;
+            r.counters.value[i] = 0;
+        }
+        for (std::size_t i = 0; i != repetitions; ++i) {
+            auto const s = sample(name, body, iterations);
+            times.push_back(s.ns / static_cast<double>(s.operations));
+            for (std::size_t c = 0; c != counter_count; ++c) {
+                r.counters.available[c] = r.counters.available[c] and s.counters.available[c];
+                r.counters.value[c] += s.counters.value[c] / static_cast<double>(s.operations * repetitions);
+            }
+        }
+        summarize(times, r);
+        output.add(r);
+    }
+
+private:
+    struct measurement {
+        double ns;
+        // Over all iterations.
+        std::size_t operations;
+        counter_values counters;
+    };
+
+    template <typename F>
+    measurement sample(std::string const& name, F& body, std::size_t iterations) {
+        state s(iterations, counters);
+        body(s);
+        if (s.remaining != 0 or s.running) {
+            std::fprintf(stderr, "%s: the case must loop until keep_running() returns false\n", name.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+        measurement m;
+        m.ns = std::chrono::duration<double, std::nano>(s.elapsed).count();
+        m.operations = iterations * s.operations;
+        m.counters = counters.read();
+        return m;
+    }
+
+    // Grows the iteration count until a run takes `min_time`.
+    template <typename F>
+    std::size_t calibrate(std::string const& name, F& body) {
+        std::size_t iterations = 1;
+        for (;;) {
+            auto const seconds = sample(name, body, iterations).ns * 1e-9;
+            if (seconds >= min_time or iterations >= std::size_t(1) << 40) return iterations;
+            auto const factor = seconds <= min_time / 10 ? 10 : 1.4 * min_time / seconds;
+            iterations = std::max(iterations + 1, static_cast<std::size_t>(static_cast<double>(iterations) * factor));
+        }
+    }
+
+    static void summarize(std::vector<double> times, result& r) {
+        std::sort(times.begin(), times.end());
+        auto const n = times.size();
+        r.min = times.front();
+        r.median = n % 2 == 1 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+        double sum = 0;
+        for (auto t : times) sum += t;
+        r.mean = sum / static_cast<double>(n);
+        double squares = 0;
+        for (auto t : times) squares += (t - r.mean) * (t - r.mean);
+        r.stddev = n > 1 ? std::sqrt(squares / static_cast<double>(n - 1)) : 0;
+    }
+
+    static bool option(char const* arg, char const* name, char const*& value) {
+        auto const length = std::strlen(name);
+        if (std::strncmp(arg, name, length) != 0 or arg[length] != '=') return false;
+        value = arg + length + 1;
+        return true;
+    }
+
+    [[noreturn]] static void usage(char const* program) {
+        std::fprintf(stderr, "usage: %s [--filter=REGEX] [--min-time=SECONDS] [--warmup=N] [--repetitions=N] "
+            "[--format=table|csv|json]\n", program);
+        std::exit(2);
+    }
+
+    format parse(int argc, char** argv) {
+        auto f = format::table;
+        for (int i = 1; i < argc; ++i) {
+            char const* value;
+            char* end = nullptr;
+            if (option(argv[i], "--filter", value)) {
+                try {
+                    filter = std::regex(value);
+                } catch (std::regex_error const&) {
+                    usage(argv[0]);
+                }
+            } else if (option(argv[i], "--min-time", value)) {
+                min_time = std::strtod(value, &end);
+            } else if (option(argv[i], "--warmup", value)) {
+                warmup = std::strtoul(value, &end, 10);
+            } else if (option(argv[i], "--repetitions", value)) {
+                repetitions = std::strtoul(value, &end, 10);
+                if (repetitions == 0) usage(argv[0]);
+            } else if (option(argv[i], "--format", value)) {
+                if (std::strcmp(value, "table") == 0) f = format::table;
+                else if (std::strcmp(value, "csv") == 0) f = format::csv;
+                else if (std::strcmp(value, "json") == 0) f = format::json;
+                else usage(argv[0]);
+            } else {
+                usage(argv[0]);
+            }
+            if (end != nullptr and (end == value or *end != '\0')) usage(argv[0]);
+        }
+        return f;
+    }
+
+    std::regex filter;
+    double min_time;
+    std::size_t warmup;
+    std::size_t repetitions;
+    writer output;
+    perf_counters counters;
+};
+
+} // namespace bench
+
+#endif // ndef BASE_BENCH_BENCHMARK_HPP
@@ -0,0 +1,86 @@
+// Summing one field over shuffled pointers to cache-line-sized nodes: a plain
+// loop against `base::gather_sum` with scalar prefetching and with hardware
+// gathers, for several prefetch distances.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gather.hpp"
+#include "ptr.hpp"
+#include "bench/benchmark.hpp"
+
+using base::ptr;
+using base::raw_ptr;
+
+namespace {
+    struct node {
+        double value;
+        char padding[56];
+    };
+
+    // One sum over all pointers per iteration; operations are pointers.
+    template <typename Sum>
+    void sums(bench::runner& runner, std::string const& name, std::vector<ptr<node const>> const& pointers,
+            double expected, Sum sum) {
+        runner.run(name, [&](bench::state& state) {
+            state.set_operations(pointers.size());
+            double result = 0;
+            while (state.keep_running()) {
+                result = sum(pointers.data(), pointers.data() + pointers.size());
+                bench::do_not_optimize(result);
+            }
+            if (result != expected) std::abort();
+        });
+    }
+
+    double gather_sum(base::simd_level level, ptr<node const> const* first, ptr<node const> const* last,
+            std::size_t distance) {
+        double buffer[256];
+        double sum = 0;
+        while (first != last) {
+            auto const n = std::min<std::size_t>(256, static_cast<std::size_t>(last - first));
+            base::detail::gather(level, first, first + n, &node::value, buffer, distance);
+            for (std::size_t i = 0; i != n; ++i) sum += buffer[i];
+            first += n;
+        }
+        return sum;
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    std::mt19937_64 random(42);
+    auto const level = base::supported_simd_level();
+
+    for (std::size_t n : { 1000, 100000, 1000000, 10000000 }) {
+        std::vector<node> nodes(n);
+        std::vector<ptr<node const>> pointers;
+        for (std::size_t i = 0; i != n; ++i) {
+            nodes[i].value = static_cast<double>(i % 1024);
+            pointers.push_back(raw_ptr(&nodes[i]));
+        }
+        std::shuffle(pointers.begin(), pointers.end(), random);
+        double expected = 0;
+        for (auto p : pointers) expected += p->value;
+
+        auto const size = '/' + std::to_string(n);
+        sums(runner, "loop" + size, pointers, expected, [](ptr<node const> const* first, ptr<node const> const* last) {
+            double sum = 0;
+            for (; first != last; ++first) sum += (*first)->value;
+            return sum;
+        });
+        for (std::size_t distance : { 8, 16, 32 }) {
+            sums(runner, "prefetch_" + std::to_string(distance) + size, pointers, expected,
+                [=](ptr<node const> const* first, ptr<node const> const* last) {
+                    return gather_sum(base::simd_level::scalar, first, last, distance);
+                });
+        }
+        sums(runner, "simd" + size, pointers, expected, [=](ptr<node const> const* first, ptr<node const> const* last) {
+            return gather_sum(level, first, last, base::default_prefetch_distance);
+        });
+    }
+}
@@ -0,0 +1,315 @@
+// Memory-level parallelism in linked structures: lists, balanced search trees
+// and hash chains, linked by raw pointers or `base::ptr`, with nodes placed
+// in construction order or at random, for working sets from L1 to DRAM. Each
+// is walked one chain at a time and with several independent chains
+// interleaved, with and without software prefetching; hash lookups sweep the
+// prefetch distance. A new pointer wrapper should match the raw pointer rows.
+// Times are per node visited, search or lookup.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ptr.hpp"
+#include "bench/benchmark.hpp"
+
+using base::ptr;
+
+namespace {
+    struct raw_pointers {
+        template <typename T>
+        using type = T*;
+
+        template <typename T>
+        static T* make(T* p) { return p; }
+
+        static char const* name() { return "raw"; }
+    };
+
+    struct base_pointers {
+        template <typename T>
+        using type = ptr<T>;
+
+        template <typename T>
+        static ptr<T> make(T* p) { return base::raw_ptr(p); }
+
+        static char const* name() { return "ptr"; }
+    };
+
+    template <typename T>
+    void prefetch(T* p) { __builtin_prefetch(p); }
+
+    template <typename T>
+    void prefetch(ptr<T> p) { __builtin_prefetch(p.get()); }
+
+    // All nodes are a cache line, so the working set is 64 bytes per node.
+    template <typename P>
+    struct list_node {
+        typename P::template type<list_node> next;
+        long value;
+        char payload[48];
+    };
+
+    template <typename P>
+    struct tree_node {
+        typename P::template type<tree_node> left;
+        typename P::template type<tree_node> right;
+        long key;
+        char payload[40];
+    };
+
+    template <typename P>
+    struct hash_entry {
+        typename P::template type<hash_entry> next;
+        long key;
+        long value;
+        char payload[40];
+    };
+
+    // Slot of the i-th node in construction order.
+    std::vector<std::size_t> placement(std::size_t n, bool random_layout, std::mt19937_64& random) {
+        std::vector<std::size_t> slots(n);
+        for (std::size_t i = 0; i != n; ++i) slots[i] = i;
+        if (random_layout) std::shuffle(slots.begin(), slots.end(), random);
+        return slots;
+    }
+
+    // `chains` cyclic lists of equal length over all nodes.
+    template <typename P>
+    std::vector<typename P::template type<list_node<P>>> make_lists(std::vector<list_node<P>>& nodes,
+            std::vector<std::size_t> const& slots, std::size_t chains) {
+        auto const at = [&](std::size_t i) { return P::make(&nodes[slots[i]]); };
+        auto const length = nodes.size() / chains;
+        std::vector<typename P::template type<list_node<P>>> heads;
+        for (std::size_t c = 0; c != chains; ++c) {
+            auto const first = c * length;
+            for (std::size_t i = 0; i != length; ++i) {
+                at(first + i)->value = 1;
+                at(first + i)->next = at(first + (i + 1) % length);
+            }
+            heads.push_back(at(first));
+        }
+        return heads;
+    }
+
+    // Advances all chains by one node per iteration. With `Prefetch`, each
+    // successor is prefetched as soon as it is known, before the work on the
+    // current node.
+    template <bool Prefetch, typename Pointer>
+    void walk(bench::state& state, std::vector<Pointer> cursors) {
+        state.set_operations(cursors.size());
+        long sum = 0;
+        while (state.keep_running()) {
+            for (auto& cursor : cursors) {
+                auto const next = cursor->next;
+                if (Prefetch) prefetch(next);
+                sum += cursor->value;
+                cursor = next;
+            }
+        }
+        bench::do_not_optimize(sum);
+    }
+
+    // Balanced search tree over the keys [first, last), nodes taken in
+    // preorder.
+    template <typename P>
+    typename P::template type<tree_node<P>> make_tree(long first, long last, std::vector<tree_node<P>>& nodes,
+            std::vector<std::size_t> const& slots, std::size_t& next) {
+        if (first == last) return nullptr;
+        auto const middle = first + (last - first) / 2;
+        auto const node = P::make(&nodes[slots[next++]]);
+        node->key = middle;
+        node->left = make_tree(first, middle, nodes, slots, next);
+        node->right = make_tree(middle + 1, last, nodes, slots, next);
+        return node;
+    }
+
+    // Searches for `group` keys per iteration, taking one step in each search
+    // of the group in turn. With `Prefetch`, both children of a node are
+    // prefetched before the comparison picks one.
+    template <bool Prefetch, typename Pointer>
+    void search(bench::state& state, Pointer root, std::vector<long> const& keys, std::size_t group) {
+        state.set_operations(group);
+        std::size_t found = 0;
+        std::vector<Pointer> cursors(group);
+        std::size_t first = 0;
+        while (state.keep_running()) {
+            if (first + group > keys.size()) first = 0;
+            std::fill(cursors.begin(), cursors.end(), root);
+            for (std::size_t active = group; active != 0;) {
+                active = 0;
+                for (std::size_t k = 0; k != group; ++k) {
+                    auto& node = cursors[k];
+                    if (node == nullptr) continue;
+                    if (Prefetch) {
+                        prefetch(node->left);
+                        prefetch(node->right);
+                    }
+                    auto const key = keys[first + k];
+                    if (key == node->key) {
+                        ++found;
+                        node = nullptr;
+                        continue;
+                    }
+                    node = key < node->key ? node->left : node->right;
+                    ++active;
+                }
+            }
+            first += group;
+        }
+        if (found != state.iterations() * group) std::abort();
+    }
+
+    // Chained hash table with two entries per bucket on average.
+    template <typename P>
+    struct hash_table {
+        using pointer = typename P::template type<hash_entry<P>>;
+
+        std::vector<pointer> buckets;
+        unsigned shift;
+
+        std::size_t bucket(long key) const {
+            return static_cast<std::size_t>((static_cast<std::uint64_t>(key) * 11400714819323198485ull) >> shift);
+        }
+    };
+
+    // Entries with the keys [0, n); in construction order, the entries of a
+    // bucket are adjacent.
+    template <typename P>
+    hash_table<P> make_table(std::vector<hash_entry<P>>& entries, std::vector<std::size_t> const& slots) {
+        hash_table<P> table;
+        table.shift = 64;
+        while (std::size_t(1) << (64 - table.shift) < entries.size() / 2) --table.shift;
+        table.buckets.assign(std::size_t(1) << (64 - table.shift), nullptr);
+
+        std::vector<long> keys(entries.size());
+        for (std::size_t i = 0; i != keys.size(); ++i) keys[i] = static_cast<long>(i);
+        std::stable_sort(keys.begin(), keys.end(),
+            [&table](long a, long b) { return table.bucket(a) < table.bucket(b); });
+        for (std::size_t i = 0; i != keys.size(); ++i) {
+            auto const entry = P::make(&entries[slots[i]]);
+            auto& head = table.buckets[table.bucket(keys[i])];
+            entry->key = keys[i];
+            entry->value = 1;
+            entry->next = head;
+            head = entry;
+        }
+        return table;
+    }
+
+    // Looks up `group` keys per iteration, one chain step per lookup in
+    // turn. With a `distance`, the bucket of the lookup that far ahead and the
+    // bucket slot of the one twice as far ahead are prefetched.
+    template <typename P>
+    void lookup(bench::state& state, hash_table<P> const& table, std::vector<long> const& keys, std::size_t group,
+            std::size_t distance) {
+        state.set_operations(group);
+        long sum = 0;
+        std::vector<typename hash_table<P>::pointer> cursors(group);
+        std::size_t first = 0;
+        while (state.keep_running()) {
+            if (first + group > keys.size()) first = 0;
+            for (std::size_t k = 0; k != group; ++k) {
+                auto const i = first + k;
+                if (distance != 0) {
+                    __builtin_prefetch(&table.buckets[table.bucket(keys[(i + 2 * distance) % keys.size()])]);
+                    prefetch(table.buckets[table.bucket(keys[(i + distance) % keys.size()])]);
+                }
+                cursors[k] = table.buckets[table.bucket(keys[i])];
+            }
+            for (std::size_t active = group; active != 0;) {
+                active = 0;
+                for (std::size_t k = 0; k != group; ++k) {
+                    auto& entry = cursors[k];
+                    if (entry == nullptr) continue;
+                    if (entry->key == keys[first + k]) {
+                        sum += entry->value;
+                        entry = nullptr;
+                        continue;
+                    }
+                    entry = entry->next;
+                    ++active;
+                }
+            }
+            first += group;
+        }
+        if (sum != static_cast<long>(state.iterations() * group)) std::abort();
+    }
+
+    std::string case_name(char const* structure, char const* pointers, bool random_layout, std::size_t nodes,
+            std::string const& variant) {
+        return std::string(structure) + '/' + pointers + '/' + (random_layout ? "random" : "sequential") + '/' +
+            std::to_string(nodes * 64 / 1024) + "KiB/" + variant;
+    }
+
+    // Keys for the searches and lookups.
+    std::size_t const queries = 1 << 20;
+
+    template <typename P>
+    void run(bench::runner& runner, std::mt19937_64& random) {
+        static_assert(sizeof(list_node<P>) == 64 and sizeof(tree_node<P>) == 64 and sizeof(hash_entry<P>) == 64,
+            "nodes are one cache line");
+
+        // 32 KiB, 1 MiB, 16 MiB and 256 MiB.
+        for (std::size_t n : { 1u << 9, 1u << 14, 1u << 18, 1u << 22 }) {
+            for (bool random_layout : { false, true }) {
+                auto const slots = placement(n, random_layout, random);
+                auto const name = [&](char const* structure, std::string const& variant) {
+                    return case_name(structure, P::name(), random_layout, n, variant);
+                };
+
+                {
+                    std::vector<list_node<P>> nodes(n);
+                    for (std::size_t chains : { 1, 8 }) {
+                        auto const heads = make_lists(nodes, slots, chains);
+                        auto const variant = "chains=" + std::to_string(chains);
+                        runner.run(name("list", variant), [&](bench::state& state) { walk<false>(state, heads); });
+                        runner.run(name("list", variant + "/prefetch"),
+                            [&](bench::state& state) { walk<true>(state, heads); });
+                    }
+                }
+
+                {
+                    std::vector<tree_node<P>> nodes(n);
+                    std::size_t next = 0;
+                    auto const root = make_tree<P>(0, static_cast<long>(n), nodes, slots, next);
+                    std::vector<long> keys(queries);
+                    for (auto& key : keys) key = static_cast<long>(random() % n);
+                    for (std::size_t group : { 1, 8 }) {
+                        auto const variant = "group=" + std::to_string(group);
+                        runner.run(name("tree", variant),
+                            [&](bench::state& state) { search<false>(state, root, keys, group); });
+                        runner.run(name("tree", variant + "/prefetch"),
+                            [&](bench::state& state) { search<true>(state, root, keys, group); });
+                    }
+                }
+
+                {
+                    std::vector<hash_entry<P>> entries(n);
+                    auto const table = make_table(entries, slots);
+                    std::vector<long> keys(queries);
+                    for (auto& key : keys) key = static_cast<long>(random() % n);
+                    for (std::size_t group : { 1, 8 }) {
+                        for (std::size_t distance : { 0, 4, 16, 64 }) {
+                            auto const variant = "group=" + std::to_string(group) +
+                                (distance != 0 ? "/distance=" + std::to_string(distance) : std::string());
+                            runner.run(name("hash", variant),
+                                [&](bench::state& state) { lookup(state, table, keys, group, distance); });
+                        }
+                    }
+                }
+            }
+        }
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    std::mt19937_64 random(42);
+    run<raw_pointers>(runner, random);
+    run<base_pointers>(runner, random);
+}
@@ -0,0 +1,89 @@
+// Scanning an edge array of `ptr`s against the same edges in a
+// `base::packed_ptr_array`, read entry by entry and unpacked in blocks, and
+// the throughput of bulk packing and unpacking at each SIMD level. Times
+// are per entry.
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "packed_ptr_array.hpp"
+#include "ptr.hpp"
+#include "bench/benchmark.hpp"
+
+using base::ptr;
+using base::raw_ptr;
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    std::mt19937_64 random(42);
+
+    // Edges into a small set of targets, so that the scans are bound by
+    // reading the edge array rather than by the targets.
+    std::vector<long> targets(1024);
+    for (std::size_t i = 0; i != targets.size(); ++i) targets[i] = static_cast<long>(i);
+
+    for (std::size_t n : { 1000, 100000, 10000000 }) {
+        std::vector<ptr<long>> edges(n);
+        for (auto& edge : edges) edge = raw_ptr(&targets[random() % targets.size()]);
+        base::packed_ptr_array<long> packed(edges.data(), edges.data() + n);
+        auto const size = '/' + std::to_string(n);
+
+        runner.run("scan/ptr" + size, [&](bench::state& state) {
+            state.set_operations(n);
+            while (state.keep_running()) {
+                long sum = 0;
+                for (auto edge : edges) sum += *edge;
+                bench::do_not_optimize(sum);
+            }
+        });
+
+        runner.run("scan/packed" + size, [&](bench::state& state) {
+            state.set_operations(n);
+            while (state.keep_running()) {
+                long sum = 0;
+                for (ptr<long> edge : packed) sum += *edge;
+                bench::do_not_optimize(sum);
+            }
+        });
+
+        runner.run("scan/packed_blocks" + size, [&](bench::state& state) {
+            state.set_operations(n);
+            ptr<long> block[256];
+            while (state.keep_running()) {
+                long sum = 0;
+                for (std::size_t first = 0; first < n; first += 256) {
+                    auto const count = std::min<std::size_t>(256, n - first);
+                    packed.unpack(first, count, block);
+                    for (std::size_t i = 0; i != count; ++i) sum += *block[i];
+                }
+                bench::do_not_optimize(sum);
+            }
+        });
+
+        for (auto level : { base::simd_level::scalar, base::simd_level::avx2 }) {
+            if (level > base::supported_simd_level()) break;
+            auto const suffix = (level == base::simd_level::scalar ? "/scalar" : "/avx2") + size;
+            std::vector<unsigned char> bytes(6 * n);
+            std::vector<ptr<long>> out(n);
+
+            runner.run("pack" + suffix, [&](bench::state& state) {
+                state.set_operations(n);
+                while (state.keep_running()) {
+                    base::detail::pack(level, edges.data(), edges.data() + n, bytes.data());
+                    bench::clobber_memory();
+                }
+            });
+
+            runner.run("unpack" + suffix, [&](bench::state& state) {
+                state.set_operations(n);
+                while (state.keep_running()) {
+                    base::detail::unpack(level, bytes.data(), n, bytes.size(), out.data());
+                    bench::clobber_memory();
+                }
+            });
+        }
+    }
+}
@@ -0,0 +1,140 @@
+#ifndef BASE_BENCH_PERF_COUNTERS_HPP
+#define BASE_BENCH_PERF_COUNTERS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#   include <linux/perf_event.h>
+#   include <sys/ioctl.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
+
+// Hardware performance counters for benchmarks, read with perf_event_open
+// on Linux. Counters the kernel refuses (no PMU in a VM or container, or a
+// restrictive perf_event_paranoid) are simply reported as unavailable, so
+// benchmarks still produce timings everywhere.
+
+namespace bench {
+
+enum class counter {
+    instructions,
+    cache_misses,
+    dtlb_misses,
+    branch_misses
+};
+
+constexpr std::size_t counter_count = 4;
+
+inline char const* counter_name(counter c) noexcept {
+    switch (c) {
+        case counter::instructions: return "instructions";
+        case counter::cache_misses: return "cache_misses";
+        case counter::dtlb_misses: return "dtlb_misses";
+        case counter::branch_misses: return "branch_misses";
+    }
+    return "";
+}
+
+// Counts since the last `reset`, scaled up if the kernel had to
+// multiplex the counters.
+struct counter_values {
+    bool available[counter_count];
+    double value[counter_count];
+
+    bool has(counter c) const noexcept { return available[static_cast<std::size_t>(c)]; }
+    double operator [](counter c) const noexcept { return value[static_cast<std::size_t>(c)]; }
+};
+
+class perf_counters {
+public:
+    perf_counters() noexcept {
+        for (std::size_t i = 0; i != counter_count; ++i) fds[i] = open(static_cast<counter>(i));
+    }
+
+    perf_counters(perf_counters const&) = delete;
+    perf_counters& operator =(perf_counters const&) = delete;
+
+    ~perf_counters() {
+#ifdef __linux__
+        for (auto fd : fds) if (fd != -1) ::close(fd);
+#endif
+    }
+
+    // Whether any counter could be opened.
+    bool available() const noexcept {
+        for (auto fd : fds) if (fd != -1) return true;
+        return false;
+    }
+
+    void reset() noexcept {
+#ifdef __linux__
+        for (auto fd : fds) if (fd != -1) ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+#endif
+    }
+
+    // Counting accumulates over `start`/`stop` pairs until the next `reset`.
+    void start() noexcept {
+#ifdef __linux__
+        for (auto fd : fds) if (fd != -1) ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    void stop() noexcept {
+#ifdef __linux__
+        for (auto fd : fds) if (fd != -1) ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    }
+
+    counter_values read() const noexcept {
+        counter_values result;
+        for (std::size_t i = 0; i != counter_count; ++i) {
+            result.available[i] = false;
+            result.value[i] = 0;
+#ifdef __linux__
+            // value, time enabled, time running
+            std::uint64_t data[3];
+            if (fds[i] == -1 or ::read(fds[i], data, sizeof data) != sizeof data or data[2] == 0) continue;
+            result.available[i] = true;
+            result.value[i] = static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+#endif
+        }
+        return result;
+    }
+
+private:
+    static int open(counter c) noexcept {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof attr);
+        attr.size = sizeof attr;
+        attr.type = PERF_TYPE_HARDWARE;
+        switch (c) {
+            case counter::instructions: attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+            case counter::cache_misses: attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+            case counter::branch_misses: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+            case counter::dtlb_misses:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_DTLB | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                    PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+                break;
+        }
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        static_cast<void>(c);
+        return -1;
+#endif
+    }
+
+    int fds[counter_count];
+};
+
+} // namespace bench
+
+#endif // ndef BASE_BENCH_PERF_COUNTERS_HPP
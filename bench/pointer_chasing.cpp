@@ -0,0 +1,102 @@
+// Chasing a random cyclic list through raw pointers, `base::ptr` and 32-bit
+// offsets into an array, with nodes in sequential or random order, for
+// working sets from L1 up to DRAM. Times and hardware counters, where the
+// kernel provides them, are per dereference; see bench/benchmark.hpp for the
+// options and output formats.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ptr.hpp"
+#include "bench/benchmark.hpp"
+
+using base::ptr;
+using base::raw_ptr;
+
+namespace {
+    // Nodes are padded to a cache line so every step is a separate line.
+    struct raw_node {
+        raw_node* next;
+        char payload[56];
+    };
+
+    struct ptr_node {
+        ptr<ptr_node> next;
+        char payload[56];
+    };
+
+    struct offset_node {
+        std::uint32_t next;
+        char payload[60];
+    };
+
+    // Order in which the list visits the slots: one cycle through all of
+    // them, either in slot order or random (Sattolo's algorithm).
+    std::vector<std::size_t> cycle(std::size_t n, bool random_layout, std::mt19937_64& random) {
+        std::vector<std::size_t> order(n);
+        for (std::size_t i = 0; i != n; ++i) order[i] = i;
+        if (random_layout) {
+            for (std::size_t i = n - 1; i != 0; --i) std::swap(order[i], order[random() % i]);
+        }
+        return order;
+    }
+
+    raw_node* link(std::vector<raw_node>& nodes, std::vector<std::size_t> const& order) {
+        for (std::size_t i = 0; i != order.size(); ++i) {
+            nodes[order[i]].next = &nodes[order[(i + 1) % order.size()]];
+        }
+        return &nodes[order[0]];
+    }
+
+    ptr<ptr_node> link(std::vector<ptr_node>& nodes, std::vector<std::size_t> const& order) {
+        for (std::size_t i = 0; i != order.size(); ++i) {
+            nodes[order[i]].next = raw_ptr(&nodes[order[(i + 1) % order.size()]]);
+        }
+        return raw_ptr(&nodes[order[0]]);
+    }
+
+    std::uint32_t link(std::vector<offset_node>& nodes, std::vector<std::size_t> const& order) {
+        for (std::size_t i = 0; i != order.size(); ++i) {
+            nodes[order[i]].next = static_cast<std::uint32_t>(order[(i + 1) % order.size()]);
+        }
+        return static_cast<std::uint32_t>(order[0]);
+    }
+
+    raw_node* step(std::vector<raw_node> const&, raw_node* n) { return n->next; }
+    ptr<ptr_node> step(std::vector<ptr_node> const&, ptr<ptr_node> n) { return n->next; }
+    std::uint32_t step(std::vector<offset_node> const& nodes, std::uint32_t n) { return nodes[n].next; }
+
+    // One dereference per iteration; the final position keeps the loop from
+    // being optimised away.
+    template <typename Node>
+    void chase(bench::runner& runner, char const* kind, std::size_t n, bool random_layout, std::mt19937_64& random) {
+        auto const name = std::string(kind) + '/' + (random_layout ? "random" : "sequential") + '/' +
+            std::to_string(n * sizeof(Node) / 1024) + "KiB";
+        if (not runner.selected(name)) return;
+
+        std::vector<Node> nodes(n);
+        auto const head = link(nodes, cycle(n, random_layout, random));
+        runner.run(name, [&](bench::state& state) {
+            auto position = head;
+            while (state.keep_running()) position = step(nodes, position);
+            bench::do_not_optimize(position);
+        });
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    std::mt19937_64 random(42);
+    // 16 KiB (L1) to 256 MiB (DRAM) at 64 bytes per node.
+    for (std::size_t n : { 1u << 8, 1u << 12, 1u << 15, 1u << 18, 1u << 22 }) {
+        for (bool random_layout : { false, true }) {
+            chase<raw_node>(runner, "raw", n, random_layout, random);
+            chase<ptr_node>(runner, "ptr", n, random_layout, random);
+            chase<offset_node>(runner, "offset", n, random_layout, random);
+        }
+    }
+}
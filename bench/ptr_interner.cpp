@@ -0,0 +1,77 @@
+// Intersecting two sets of heap pointers: `std::unordered_set` against
+// `ptr_bitset`s over IDs from a `ptr_interner`. Interning is timed on its own,
+// since a dataflow pass interns once and then combines sets many times.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "ptr.hpp"
+#include "ptr_interner.hpp"
+#include "ptr_traits.hpp"
+#include "bench/benchmark.hpp"
+
+using base::ptr;
+using base::raw_ptr;
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    std::mt19937_64 random(42);
+
+    for (std::size_t n : { 1000, 100000, 1000000 }) {
+        std::vector<int> objects(n);
+        std::vector<ptr<int>> a, b;
+        for (auto& object : objects) {
+            if (random() % 2) a.push_back(raw_ptr(&object));
+            if (random() % 2) b.push_back(raw_ptr(&object));
+        }
+        std::shuffle(a.begin(), a.end(), random);
+        std::shuffle(b.begin(), b.end(), random);
+        auto const size = '/' + std::to_string(n);
+
+        std::unordered_set<ptr<int>> hash_a(a.begin(), a.end());
+        std::unordered_set<ptr<int>> hash_b(b.begin(), b.end());
+        std::size_t hash_count = 0;
+        for (auto p : hash_a) hash_count += hash_b.count(p);
+        // Operations are the elements of the first set.
+        runner.run("unordered_set" + size, [&](bench::state& state) {
+            state.set_operations(a.size());
+            while (state.keep_running()) {
+                std::size_t count = 0;
+                for (auto p : hash_a) count += hash_b.count(p);
+                bench::do_not_optimize(count);
+            }
+        });
+
+        runner.run("intern" + size, [&](bench::state& state) {
+            state.set_operations(a.size() + b.size());
+            base::ptr_interner<int> interner;
+            base::ptr_bitset bits_a, bits_b;
+            while (state.keep_running()) {
+                state.pause_timing();
+                interner.clear();
+                bits_a.clear();
+                bits_b.clear();
+                state.resume_timing();
+                for (auto p : a) bits_a.set(interner.intern(p));
+                for (auto p : b) bits_b.set(interner.intern(p));
+                bench::clobber_memory();
+            }
+        });
+
+        base::ptr_interner<int> interner;
+        base::ptr_bitset bits_a, bits_b;
+        for (auto p : a) bits_a.set(interner.intern(p));
+        for (auto p : b) bits_b.set(interner.intern(p));
+        runner.run("bitset" + size, [&](bench::state& state) {
+            state.set_operations(a.size());
+            while (state.keep_running()) bench::do_not_optimize((bits_a & bits_b).count());
+        });
+        bits_a &= bits_b;
+        if (bits_a.count() != hash_count) std::abort();
+    }
+}
@@ -0,0 +1,103 @@
+// Throughput of passing pointers from producer to consumer threads through
+// `spsc_ptr_queue`, `mpmc_ptr_queue` and a mutex-guarded `std::deque`, one
+// element at a time and in batches, for 1 up to the number of cores threads
+// on each side. Times are per element passed.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ptr.hpp"
+#include "ptr_queue.hpp"
+#include "bench/benchmark.hpp"
+
+using base::ptr;
+using base::raw_ptr;
+
+namespace {
+    constexpr std::size_t items_per_run = 1000000;
+    constexpr std::size_t capacity = 1024;
+
+    class locked_deque {
+    public:
+        explicit locked_deque(std::size_t capacity) : capacity(capacity) { }
+
+        std::size_t push(ptr<int> const* first, ptr<int> const* last) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto const n = std::min(static_cast<std::size_t>(last - first), capacity - values.size());
+            values.insert(values.end(), first, first + n);
+            return n;
+        }
+
+        std::size_t pop(ptr<int>* out, std::size_t max) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto const n = std::min(max, values.size());
+            std::copy(values.begin(), values.begin() + n, out);
+            values.erase(values.begin(), values.begin() + n);
+            return n;
+        }
+
+    private:
+        std::size_t capacity;
+        std::mutex mutex;
+        std::deque<ptr<int>> values;
+    };
+
+    // Passes `items_per_run` elements through `queue` with `threads`
+    // producers and as many consumers.
+    template <typename Queue>
+    void transfer(Queue& queue, unsigned threads, std::size_t batch) {
+        static int object;
+        std::vector<ptr<int>> const input(batch, raw_ptr(&object));
+        auto const per_producer = items_per_run / threads;
+        std::atomic<std::size_t> remaining(per_producer * threads);
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t != threads; ++t) {
+            workers.emplace_back([&] {
+                for (std::size_t left = per_producer; left != 0;) {
+                    auto const pushed = queue.push(input.data(), input.data() + std::min(batch, left));
+                    if (pushed == 0) std::this_thread::yield();
+                    left -= pushed;
+                }
+            });
+            workers.emplace_back([&] {
+                std::vector<ptr<int>> output(batch);
+                while (remaining.load(std::memory_order_relaxed) != 0) {
+                    auto const popped = queue.pop(output.data(), batch);
+                    if (popped == 0) std::this_thread::yield();
+                    remaining -= popped;
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+    }
+
+    template <typename Queue>
+    void throughput(bench::runner& runner, std::string const& name, unsigned threads, std::size_t batch) {
+        runner.run(name + '/' + std::to_string(threads) + "x" + std::to_string(batch), [&](bench::state& state) {
+            state.set_operations(items_per_run / threads * threads);
+            Queue queue(capacity);
+            while (state.keep_running()) transfer(queue, threads, batch);
+        });
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    auto const cores = std::max(1u, std::thread::hardware_concurrency());
+
+    // Cases are named queue/threads x batch.
+    for (unsigned threads = 1; threads <= cores; threads *= 2) {
+        for (std::size_t batch : { 1, 32 }) {
+            if (threads == 1) throughput<base::spsc_ptr_queue<int>>(runner, "spsc", threads, batch);
+            throughput<base::mpmc_ptr_queue<int>>(runner, "mpmc", threads, batch);
+            throughput<locked_deque>(runner, "deque", threads, batch);
+        }
+    }
+}
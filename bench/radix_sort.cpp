@@ -0,0 +1,55 @@
+// Sorting shuffled heap pointers with `base::radix_sort` against `std::sort`.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ptr.hpp"
+#include "radix_sort.hpp"
+#include "bench/benchmark.hpp"
+
+using base::ptr;
+using base::raw_ptr;
+
+namespace {
+    // One sort of a fresh copy of `input` per iteration; operations are
+    // elements.
+    template <typename Sort>
+    void sorts(bench::runner& runner, std::string const& name, std::vector<ptr<int>> const& input, Sort sort) {
+        runner.run(name, [&](bench::state& state) {
+            state.set_operations(input.size());
+            auto values = input;
+            while (state.keep_running()) {
+                state.pause_timing();
+                values = input;
+                state.resume_timing();
+                sort(values.data(), values.data() + values.size());
+                bench::clobber_memory();
+            }
+            if (not std::is_sorted(values.begin(), values.end())) std::abort();
+        });
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    std::mt19937_64 random(42);
+    auto const threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (std::size_t n : { 1000, 100000, 1000000, 10000000 }) {
+        std::vector<int> objects(n);
+        std::vector<ptr<int>> values;
+        for (auto& object : objects) values.push_back(raw_ptr(&object));
+        std::shuffle(values.begin(), values.end(), random);
+
+        auto const size = '/' + std::to_string(n);
+        sorts(runner, "std::sort" + size, values, [](ptr<int>* first, ptr<int>* last) { std::sort(first, last); });
+        sorts(runner, "radix" + size, values, [](ptr<int>* first, ptr<int>* last) { base::radix_sort(first, last); });
+        sorts(runner, "radix_mt" + size, values,
+            [=](ptr<int>* first, ptr<int>* last) { base::radix_sort(first, last, threads); });
+    }
+}
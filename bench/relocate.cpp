@@ -0,0 +1,176 @@
+// Traversing a binary tree whose nodes are scattered over a large pool,
+// before and after `base::compact` has copied them into breadth-first order;
+// then random searches in a balanced search tree after `base::relayout` into
+// each `layout_order`.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ptr.hpp"
+#include "ptr_fields.hpp"
+#include "relocate.hpp"
+#include "bench/benchmark.hpp"
+
+using base::ptr;
+using base::raw_ptr;
+
+namespace {
+    struct node {
+        long value;
+        ptr<node> left;
+        ptr<node> right;
+        char payload[40];
+    };
+} // namespace
+
+namespace base {
+    template <>
+    struct ptr_fields<node> {
+        template <typename F>
+        static void visit(node& n, F&& f) {
+            f(n.left);
+            f(n.right);
+        }
+    };
+} // namespace base
+
+namespace {
+    // Depth-first sum over the tree, with an explicit stack.
+    long sum(ptr<node> root) {
+        long result = 0;
+        std::vector<ptr<node>> stack = { root };
+        while (not stack.empty()) {
+            auto const n = stack.back();
+            stack.pop_back();
+            result += n->value;
+            if (n->right != nullptr) stack.push_back(n->right);
+            if (n->left != nullptr) stack.push_back(n->left);
+        }
+        return result;
+    }
+
+    // One traversal per iteration; operations are nodes.
+    void sums(bench::runner& runner, std::string const& name, ptr<node> root, std::size_t n, long expected) {
+        runner.run(name, [&](bench::state& state) {
+            state.set_operations(n);
+            long result = 0;
+            while (state.keep_running()) {
+                result = sum(root);
+                bench::do_not_optimize(result);
+            }
+            if (result != expected) std::abort();
+        });
+    }
+
+    // Random binary tree of `n` nodes placed at random positions in `pool`.
+    ptr<node> scattered_tree(std::vector<node>& pool, std::size_t n, std::mt19937_64& random) {
+        pool.assign(n, node());
+        std::vector<std::size_t> slots(n);
+        for (std::size_t i = 0; i != n; ++i) slots[i] = i;
+        std::shuffle(slots.begin(), slots.end(), random);
+        auto const at = [&](std::size_t i) { return raw_ptr(&pool[slots[i]]); };
+        for (std::size_t i = 1; i != n; ++i) {
+            auto parent = at(0);
+            // Random descent to a free child slot.
+            for (;;) {
+                auto& child = random() % 2 ? parent->left : parent->right;
+                if (child == nullptr) {
+                    child = at(i);
+                    break;
+                }
+                parent = child;
+            }
+            at(i)->value = static_cast<long>(i);
+        }
+        return at(0);
+    }
+
+    // Balanced search tree over the keys [first, last), whose nodes are taken
+    // from `nodes` in order.
+    ptr<node> search_tree(long first, long last, ptr<node>*& nodes) {
+        if (first == last) return nullptr;
+        auto const middle = first + (last - first) / 2;
+        auto const n = *nodes++;
+        n->value = middle;
+        n->left = search_tree(first, middle, nodes);
+        n->right = search_tree(middle + 1, last, nodes);
+        return n;
+    }
+
+    bool search(ptr<node> root, long key) {
+        while (root != nullptr) {
+            if (key == root->value) return true;
+            root = key < root->value ? root->left : root->right;
+        }
+        return false;
+    }
+
+    // One search per iteration, cycling through the keys.
+    void searches(bench::runner& runner, std::string const& name, ptr<node> root, std::vector<long> const& keys) {
+        runner.run(name, [&](bench::state& state) {
+            std::size_t i = 0;
+            std::size_t found = 0;
+            while (state.keep_running()) {
+                found += search(root, keys[i]);
+                if (++i == keys.size()) i = 0;
+            }
+            if (found != state.iterations()) std::abort();
+        });
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    std::mt19937_64 random(42);
+
+    for (std::size_t n : { 10000, 100000, 1000000, 4000000 }) {
+        std::vector<node> pool;
+        auto const scattered = scattered_tree(pool, n, random);
+        auto const expected = sum(scattered);
+        auto const size = '/' + std::to_string(n);
+
+        sums(runner, "sum/scattered" + size, scattered, n, expected);
+        // Operations are nodes copied.
+        runner.run("compact" + size, [&](bench::state& state) {
+            state.set_operations(n);
+            while (state.keep_running()) {
+                auto root = scattered;
+                bench::do_not_optimize(base::compact(root));
+            }
+        });
+        auto root = scattered;
+        auto const arena = base::compact(root);
+        sums(runner, "sum/compacted" + size, root, n, expected);
+    }
+
+    for (std::size_t n : { 10000, 100000, 1000000, 4000000 }) {
+        std::vector<node> pool(n);
+        std::vector<ptr<node>> slots;
+        for (auto& p : pool) slots.push_back(raw_ptr(&p));
+        std::shuffle(slots.begin(), slots.end(), random);
+        auto next = slots.data();
+        auto const scattered = search_tree(0, static_cast<long>(n), next);
+        std::vector<long> keys(1 << 20);
+        for (auto& key : keys) key = static_cast<long>(random() % n);
+        auto const size = '/' + std::to_string(n);
+
+        searches(runner, "search/scattered" + size, scattered, keys);
+        struct {
+            char const* name;
+            base::layout_order order;
+        } const orders[] = {
+            { "bfs", base::layout_order::breadth_first },
+            { "dfs", base::layout_order::depth_first },
+            { "veb", base::layout_order::van_emde_boas }
+        };
+        for (auto const& order : orders) {
+            auto root = scattered;
+            auto const arena = base::relayout(root, order.order);
+            searches(runner, std::string("search/") + order.name + size, root, keys);
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef BASE_BENCH_REPORT_HPP
+#define BASE_BENCH_REPORT_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include "perf_counters.hpp"
+
+// Output of benchmark results as an aligned table (for reading), CSV or JSON
+// (for tracking results over releases). Times and counters are reported per
+// operation, where an operation is whatever unit the case declares (a
+// pointer dereference, a lookup, an element sorted, ...).
+
+namespace bench {
+
+struct result {
+    std::string name;
+    // Per repetition.
+    std::size_t iterations;
+    std::size_t repetitions;
+    // Nanoseconds per operation over the repetitions.
+    double median;
+    double mean;
+    double min;
+    double stddev;
+    // Per operation, averaged over the repetitions.
+    counter_values counters;
+};
+
+enum class format {
+    table,
+    csv,
+    json
+};
+
+// Writes each result as soon as it is added, so that long runs show
+// progress; the JSON array is closed on destruction.
+class writer {
+public:
+    explicit writer(format f) noexcept : f(f), rows() {
+        switch (f) {
+            case format::table:
+                std::printf("%-50s %12s %5s %10s %10s %8s", "case", "iterations", "reps", "ns/op", "min", "stddev");
+                for (std::size_t i = 0; i != counter_count; ++i) {
+                    std::printf(" %14s", counter_name(static_cast<counter>(i)));
+                }
+                std::printf("\n");
+                break;
+            case format::csv:
+                std::printf("name,iterations,repetitions,ns_per_op,ns_per_op_mean,ns_per_op_min,ns_per_op_stddev");
+                for (std::size_t i = 0; i != counter_count; ++i) std::printf(",%s", counter_name(static_cast<counter>(i)));
+                std::printf("\n");
+                break;
+            case format::json:
+                std::printf("[");
+                break;
+        }
+    }
+
+    writer(writer const&) = delete;
+    writer& operator =(writer const&) = delete;
+
+    ~writer() {
+        if (f == format::json) std::printf(rows == 0 ? "]\n" : "\n]\n");
+        std::fflush(stdout);
+    }
+
+    // Case names are chosen by the benchmarks and contain no quotes or
+    // commas, so they need no escaping.
+    void add(result const& r) {
+        switch (f) {
+            case format::table:
+                std::printf("%-50s %12zu %5zu %10.3f %10.3f %7.1f%%", r.name.c_str(), r.iterations, r.repetitions,
+                    r.median, r.min, r.median == 0 ? 0 : 100 * r.stddev / r.median);
+                break;
+            case format::csv:
+                std::printf("%s,%zu,%zu,%.4f,%.4f,%.4f,%.4f", r.name.c_str(), r.iterations, r.repetitions,
+                    r.median, r.mean, r.min, r.stddev);
+                break;
+            case format::json:
+                std::printf("%s\n  {\"name\": \"%s\", \"iterations\": %zu, \"repetitions\": %zu, "
+                    "\"ns_per_op\": %.4f, \"ns_per_op_mean\": %.4f, \"ns_per_op_min\": %.4f, "
+                    "\"ns_per_op_stddev\": %.4f", rows == 0 ? "" : ",", r.name.c_str(), r.iterations,
+                    r.repetitions, r.median, r.mean, r.min, r.stddev);
+                break;
+        }
+        for (std::size_t i = 0; i != counter_count; ++i) add_counter(r.counters, i);
+        std::printf(f == format::json ? "}" : "\n");
+        std::fflush(stdout);
+        ++rows;
+    }
+
+private:
+    void add_counter(counter_values const& values, std::size_t i) {
+        bool const has = values.available[i];
+        switch (f) {
+            case format::table:
+                if (has) std::printf(" %14.3f", values.value[i]); else std::printf(" %14s", "-");
+                break;
+            case format::csv:
+                if (has) std::printf(",%.4f", values.value[i]); else std::printf(",");
+                break;
+            case format::json:
+                std::printf(", \"%s\": ", counter_name(static_cast<counter>(i)));
+                if (has) std::printf("%.4f", values.value[i]); else std::printf("null");
+                break;
+        }
+    }
+
+    format f;
+    std::size_t rows;
+};
+
+} // namespace bench
+
+#endif // ndef BASE_BENCH_REPORT_HPP
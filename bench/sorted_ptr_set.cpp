@@ -0,0 +1,62 @@
+// Lookup throughput of `base::sorted_ptr_set` against node- and hash-based
+// standard containers, for sets from a few elements to beyond the L2 cache.
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "ptr.hpp"
+#include "ptr_traits.hpp"
+#include "sorted_ptr_set.hpp"
+#include "bench/benchmark.hpp"
+
+using base::ptr;
+using base::raw_ptr;
+
+namespace {
+    // One lookup per iteration, cycling through the queries.
+    template <typename Set>
+    void lookups(bench::runner& runner, std::string const& name, Set const& set,
+            std::vector<ptr<int>> const& queries) {
+        runner.run(name, [&](bench::state& state) {
+            std::size_t i = 0;
+            while (state.keep_running()) {
+                bench::do_not_optimize(set.count(queries[i]));
+                if (++i == queries.size()) i = 0;
+            }
+        });
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::runner runner(argc, argv);
+    std::mt19937_64 random(42);
+
+    for (std::size_t n : { 8, 16, 64, 512, 4096, 32768, 262144 }) {
+        // Members are the even elements, so that half of the queries miss.
+        std::vector<int> objects(2 * n);
+        std::vector<ptr<int>> members;
+        std::vector<ptr<int>> queries;
+        for (std::size_t i = 0; i != 2 * n; ++i) {
+            if (i % 2 == 0) members.push_back(raw_ptr(&objects[i]));
+            queries.push_back(raw_ptr(&objects[i]));
+        }
+        std::shuffle(members.begin(), members.end(), random);
+        std::shuffle(queries.begin(), queries.end(), random);
+
+        base::sorted_ptr_set<int> sorted(members.begin(), members.end());
+        base::sorted_ptr_set<int, base::ptr_set_layout::eytzinger> eytzinger(members.begin(), members.end());
+        std::set<ptr<int>> tree(members.begin(), members.end());
+        std::unordered_set<ptr<int>> hash(members.begin(), members.end());
+
+        auto const size = '/' + std::to_string(n);
+        lookups(runner, "sorted" + size, sorted, queries);
+        lookups(runner, "eytzinger" + size, eytzinger, queries);
+        lookups(runner, "set" + size, tree, queries);
+        lookups(runner, "unordered" + size, hash, queries);
+    }
+}
@@ -0,0 +1,182 @@
+#ifndef BASE_BINARY_TRACE_HPP
+#define BASE_BINARY_TRACE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "io_error.hpp"
+#include "ptr.hpp"
+
+namespace base {
+
+// Binary trace file: a fixed-size header followed by `count` records. The
+// header's `count` is updated on every append, so a trace cut short by a
+// crash is still readable up to the last complete record.
+struct trace_file_header {
+    char magic[8];
+    std::uint64_t version;
+    std::uint64_t record_size;
+    std::uint64_t count;
+    std::uint64_t reserved[4];
+};
+
+struct trace_record {
+    std::uint64_t value;
+    std::uint64_t tag;
+};
+
+namespace detail {
+    static_assert(sizeof(trace_file_header) == 64, "Unexpected header padding");
+    static_assert(sizeof(trace_record) == 16, "Unexpected record padding");
+
+    constexpr char trace_file_magic[8] = { 'b', 'a', 's', 'e', 't', 'r', 'c', 'e' };
+    constexpr std::uint64_t trace_file_version = 1;
+} // namespace detail
+
+// Append-only writer of `ptr` values and tags into a memory-mapped trace
+// file. Appending is two stores into the mapping plus a header update; the
+// file grows by doubling. A writer must only be used by one thread at a time.
+class binary_writer {
+public:
+    explicit binary_writer(std::string const& path, std::size_t initial_capacity = 4096)
+            : fd(::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)), name(path) {
+        if (fd == -1) throw detail::io_error(path);
+        try {
+            remap(initial_capacity == 0 ? 1 : initial_capacity);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        auto& h = header();
+        std::memcpy(h.magic, detail::trace_file_magic, sizeof h.magic);
+        h.version = detail::trace_file_version;
+        h.record_size = sizeof(trace_record);
+        h.count = 0;
+    }
+
+    binary_writer(binary_writer const&) = delete;
+    binary_writer& operator =(binary_writer const&) = delete;
+
+    // Truncates the file to the records actually written.
+    ~binary_writer() {
+        auto const size = file_size(count);
+        ::munmap(mapping, file_size(capacity));
+        static_cast<void>(::ftruncate(fd, static_cast<off_t>(size)));
+        ::close(fd);
+    }
+
+    void append(std::uint64_t value, std::uint64_t tag) {
+        if (count == capacity) remap(2 * capacity);
+        records()[count] = trace_record{value, tag};
+        header().count = ++count;
+    }
+
+    template <typename T>
+    void append(ptr<T> p, std::uint64_t tag = 0) {
+        append(static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(p.get())), tag);
+    }
+
+    // Schedules the written records for writeback without waiting for it.
+    void flush() {
+        if (::msync(mapping, file_size(count), MS_ASYNC) == -1) throw detail::io_error(name);
+    }
+
+    std::size_t size() const noexcept { return count; }
+
+private:
+    static std::size_t file_size(std::size_t records) noexcept {
+        return sizeof(trace_file_header) + records * sizeof(trace_record);
+    }
+
+    trace_file_header& header() noexcept {
+        return *static_cast<trace_file_header*>(mapping);
+    }
+
+    trace_record* records() noexcept {
+        return reinterpret_cast<trace_record*>(static_cast<char*>(mapping) + sizeof(trace_file_header));
+    }
+
+    void remap(std::size_t new_capacity) {
+        if (::ftruncate(fd, static_cast<off_t>(file_size(new_capacity))) == -1) {
+            throw detail::io_error(name);
+        }
+        void* const address = ::mmap(nullptr, file_size(new_capacity),
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) throw detail::io_error(name);
+        if (mapping != nullptr) ::munmap(mapping, file_size(capacity));
+        mapping = address;
+        capacity = new_capacity;
+    }
+
+    int fd;
+    std::string name;
+    void* mapping = nullptr;
+    std::size_t capacity = 0;
+    std::size_t count = 0;
+};
+
+// Read-only view of a trace file written by `binary_writer`.
+class binary_reader {
+public:
+    explicit binary_reader(std::string const& path) {
+        int const fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) throw detail::io_error(path);
+
+        struct stat info;
+        if (::fstat(fd, &info) == -1) {
+            auto error = detail::io_error(path);
+            ::close(fd);
+            throw error;
+        }
+
+        length = static_cast<std::size_t>(info.st_size);
+        if (length < sizeof(trace_file_header)) {
+            ::close(fd);
+            throw std::runtime_error(path + ": not a trace file");
+        }
+
+        void* const address = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED) throw detail::io_error(path);
+        mapping = address;
+
+        auto const& h = *static_cast<trace_file_header const*>(mapping);
+        auto const available = (length - sizeof h) / sizeof(trace_record);
+        if (std::memcmp(h.magic, detail::trace_file_magic, sizeof h.magic) != 0 or
+                h.version != detail::trace_file_version or
+                h.record_size != sizeof(trace_record) or h.count > available) {
+            ::munmap(mapping, length);
+            throw std::runtime_error(path + ": incompatible trace file");
+        }
+        count = static_cast<std::size_t>(h.count);
+    }
+
+    binary_reader(binary_reader const&) = delete;
+    binary_reader& operator =(binary_reader const&) = delete;
+
+    ~binary_reader() { ::munmap(mapping, length); }
+
+    std::size_t size() const noexcept { return count; }
+
+    trace_record const* begin() const noexcept {
+        return reinterpret_cast<trace_record const*>(
+            static_cast<char const*>(mapping) + sizeof(trace_file_header));
+    }
+
+    trace_record const* end() const noexcept { return begin() + count; }
+
+private:
+    void* mapping = nullptr;
+    std::size_t length = 0;
+    std::size_t count = 0;
+};
+
+} // namespace base
+
+#endif // ndef BASE_BINARY_TRACE_HPP
@@ -0,0 +1,50 @@
+#ifndef BASE_CPU_FEATURES_HPP
+#define BASE_CPU_FEATURES_HPP
+
+// Runtime detection of the vector instruction sets that kernels in this
+// library can dispatch to. Kernels for a level are compiled with GCC/Clang
+// target attributes, so the library itself needs no special compiler flags.
+
+#if defined(__GNUC__) and defined(__x86_64__)
+#   define BASE_SIMD_X86 1
+#   include <immintrin.h>
+#   define BASE_TARGET(isa) __attribute__((target(isa)))
+#else
+#   define BASE_SIMD_X86 0
+#endif
+
+namespace base {
+
+enum class simd_level {
+    scalar,
+    sse2,
+    avx2,
+    avx512
+};
+
+namespace detail {
+    inline simd_level detect_simd_level() noexcept {
+#if BASE_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return simd_level::avx512;
+        if (__builtin_cpu_supports("avx2")) return simd_level::avx2;
+        if (__builtin_cpu_supports("sse2")) return simd_level::sse2;
+#endif
+        return simd_level::scalar;
+    }
+} // namespace detail
+
+// Best level supported by the executing CPU; detected once. Code compiled
+// for AVX-512 cannot run without it, so no detection is needed in that case.
+inline simd_level supported_simd_level() noexcept {
+#if BASE_SIMD_X86 and defined(__AVX512F__)
+    return simd_level::avx512;
+#else
+    static simd_level const level = detail::detect_simd_level();
+    return level;
+#endif
+}
+
+} // namespace base
+
+#endif // ndef BASE_CPU_FEATURES_HPP
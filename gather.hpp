@@ -0,0 +1,196 @@
+#ifndef BASE_GATHER_HPP
+#define BASE_GATHER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "cpu_features.hpp"
+#include "ptr.hpp"
+
+// Loading one field from the targets of many `ptr`s. A plain loop over the
+// pointers tends to wait on one cache miss at a time; these kernels keep many
+// loads in flight, either with hardware gathers (AVX2, AVX-512) or with
+// software prefetching `prefetch_distance` elements ahead.
+
+namespace base {
+
+constexpr std::size_t default_prefetch_distance = 16;
+
+namespace detail {
+    template <typename T, typename C, typename F>
+    inline std::ptrdiff_t field_offset(T const* object, F C::* field) noexcept {
+        return reinterpret_cast<char const*>(&(object->*field)) - reinterpret_cast<char const*>(object);
+    }
+
+    template <typename T>
+    inline void prefetch(T const* address) noexcept {
+#ifdef __GNUC__
+        __builtin_prefetch(address);
+#else
+        static_cast<void>(address);
+#endif
+    }
+
+    template <typename T, typename C, typename F>
+    void gather_scalar(ptr<T> const* first, ptr<T> const* last, F C::* field, F* out,
+            std::size_t distance) noexcept {
+        auto const n = static_cast<std::size_t>(last - first);
+        std::size_t i = 0;
+        for (; i + distance < n; ++i) {
+            prefetch(&(first[i + distance].get()->*field));
+            out[i] = first[i].get()->*field;
+        }
+        for (; i != n; ++i) out[i] = first[i].get()->*field;
+    }
+
+    // Fields that hardware gathers can load: 4 or 8 bytes, copied bitwise.
+    template <typename F>
+    struct gatherable : std::integral_constant<bool,
+        std::is_trivially_copyable<F>::value and (sizeof(F) == 4 or sizeof(F) == 8)> { };
+
+    // Whether a field of `C` lies at the same offset in every `T`, as the
+    // vector kernels assume. A virtual base `C` may be placed differently in
+    // each most derived object; standard-layout classes have no virtual bases.
+    template <typename T, typename C>
+    struct fixed_field_offset : std::integral_constant<bool,
+        std::is_same<typename std::remove_cv<T>::type, C>::value or std::is_standard_layout<T>::value> { };
+
+    // Prefetches the fields of elements [i, i + count), as far as they exist.
+    inline void prefetch_fields(std::uintptr_t const* words, std::size_t n, std::size_t i, std::size_t count,
+            std::ptrdiff_t offset) noexcept {
+        for (auto const end = std::min(n, i + count); i < end; ++i) {
+            prefetch(reinterpret_cast<char const*>(words[i] + static_cast<std::uintptr_t>(offset)));
+        }
+    }
+
+#if BASE_SIMD_X86
+    // Addresses of the fields of elements [i, i + 4): pointer words plus the
+    // field offset. The gathers use them as 64-bit indices from address 0.
+    BASE_TARGET("avx2")
+    inline __m256i field_addresses_avx2(std::uintptr_t const* words, __m256i offset) noexcept {
+        return _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(words)), offset);
+    }
+
+    // The gathers wait for all their lanes, so the kernels still prefetch
+    // the fields `distance` elements ahead.
+    BASE_TARGET("avx2")
+    inline std::size_t gather_avx2(std::uintptr_t const* words, std::size_t n, std::ptrdiff_t offset,
+            std::size_t size, void* out, std::size_t distance) noexcept {
+        auto const vindex = _mm256_set1_epi64x(offset);
+        std::size_t i = 0;
+        if (size == 8) {
+            auto const dst = static_cast<char*>(out);
+            for (; i + 4 <= n; i += 4) {
+                prefetch_fields(words, n, i + distance, 4, offset);
+                auto const v = _mm256_i64gather_epi64(static_cast<long long const*>(nullptr),
+                    field_addresses_avx2(words + i, vindex), 1);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 8 * i), v);
+            }
+        } else {
+            auto const dst = static_cast<char*>(out);
+            for (; i + 4 <= n; i += 4) {
+                prefetch_fields(words, n, i + distance, 4, offset);
+                auto const v = _mm256_i64gather_epi32(static_cast<int const*>(nullptr),
+                    field_addresses_avx2(words + i, vindex), 1);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), v);
+            }
+        }
+        return i;
+    }
+
+    BASE_TARGET("avx512f")
+    inline std::size_t gather_avx512(std::uintptr_t const* words, std::size_t n, std::ptrdiff_t offset,
+            std::size_t size, void* out, std::size_t distance) noexcept {
+        auto const vindex = _mm512_set1_epi64(offset);
+        auto const dst = static_cast<char*>(out);
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            prefetch_fields(words, n, i + distance, 8, offset);
+            auto const addresses = _mm512_add_epi64(_mm512_loadu_si512(words + i), vindex);
+            // The masked forms take an explicit source, which the unmasked
+            // ones leave undefined (and GCC warns about).
+            if (size == 8) {
+                _mm512_storeu_si512(dst + 8 * i,
+                    _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), 0xff, addresses, nullptr, 1));
+            } else {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * i),
+                    _mm512_mask_i64gather_epi32(_mm256_setzero_si256(), 0xff, addresses, nullptr, 1));
+            }
+        }
+        return i;
+    }
+#endif
+
+    // Returns the number of leading elements gathered with vector gathers.
+    inline std::size_t gather_block(simd_level level, std::uintptr_t const* words, std::size_t n,
+            std::ptrdiff_t offset, std::size_t size, void* out, std::size_t distance) noexcept {
+        switch (level) {
+#if BASE_SIMD_X86
+            case simd_level::avx512: return gather_avx512(words, n, offset, size, out, distance);
+            case simd_level::avx2: return gather_avx2(words, n, offset, size, out, distance);
+#endif
+            default: return 0;
+        }
+    }
+
+    template <typename T, typename C, typename F>
+    void gather(simd_level level, ptr<T> const* first, ptr<T> const* last, F C::* field, F* out,
+            std::size_t distance, std::true_type /* vectorizable */) noexcept {
+        static_assert(sizeof(ptr<T>) == sizeof(std::uintptr_t), "ptr must be pointer-sized");
+        if (first == last) return;
+        auto const n = static_cast<std::size_t>(last - first);
+        auto const done = gather_block(level, reinterpret_cast<std::uintptr_t const*>(first), n,
+            field_offset(first->get(), field), sizeof(F), out, distance);
+        gather_scalar(first + done, last, field, out + done, distance);
+    }
+
+    template <typename T, typename C, typename F>
+    void gather(simd_level, ptr<T> const* first, ptr<T> const* last, F C::* field, F* out,
+            std::size_t distance, std::false_type /* vectorizable */) noexcept {
+        gather_scalar(first, last, field, out, distance);
+    }
+
+    template <typename T, typename C, typename F>
+    void gather(simd_level level, ptr<T> const* first, ptr<T> const* last, F C::* field, F* out,
+            std::size_t distance) noexcept {
+        gather(level, first, last, field, out, distance,
+            std::integral_constant<bool, gatherable<F>::value and fixed_field_offset<T, C>::value>());
+    }
+} // namespace detail
+
+// Stores `first[i]->*field` into `out[i]` for every element of the range.
+// All pointers must be non-null.
+template <typename T, typename C, typename F>
+inline void gather(ptr<T> const* first, ptr<T> const* last, F C::* field, F* out,
+        std::size_t prefetch_distance = default_prefetch_distance) noexcept {
+    detail::gather(supported_simd_level(), first, last, field, out, prefetch_distance);
+}
+
+// Folds `op` over the fields of all targets, starting with `init`. The
+// fields are gathered in blocks into a local buffer and folded from there.
+template <typename T, typename C, typename F, typename R, typename Op>
+R gather_reduce(ptr<T> const* first, ptr<T> const* last, F C::* field, R init, Op op,
+        std::size_t prefetch_distance = default_prefetch_distance) {
+    constexpr std::size_t block = 256;
+    F buffer[block];
+    auto const level = supported_simd_level();
+    while (first != last) {
+        auto const n = std::min<std::size_t>(block, static_cast<std::size_t>(last - first));
+        detail::gather(level, first, first + n, field, buffer, prefetch_distance);
+        for (std::size_t i = 0; i != n; ++i) init = op(init, buffer[i]);
+        first += n;
+    }
+    return init;
+}
+
+template <typename T, typename C, typename F>
+inline F gather_sum(ptr<T> const* first, ptr<T> const* last, F C::* field,
+        std::size_t prefetch_distance = default_prefetch_distance) {
+    return gather_reduce(first, last, field, F(),
+        [](F const& sum, F const& value) { return sum + value; }, prefetch_distance);
+}
+
+} // namespace base
+
+#endif // ndef BASE_GATHER_HPP
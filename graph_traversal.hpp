@@ -0,0 +1,214 @@
+#ifndef BASE_GRAPH_TRAVERSAL_HPP
+#define BASE_GRAPH_TRAVERSAL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "gather.hpp"
+#include "ptr.hpp"
+#include "ptr_fields.hpp"
+#include "ptr_queue.hpp"
+#include "ptr_traits.hpp"
+#include "work_stealing.hpp"
+
+// Traversal of graphs of `ptr`-linked nodes. The graph is given by an edge
+// extractor: a functor called as `edges(node, f)` that calls `f(target)` for
+// every outgoing edge of `node` (null targets are skipped). The visitor is
+// called as `visit(node, depth)` once per reachable node and returns whether
+// to continue; returning false stops the traversal early.
+
+namespace base {
+
+struct traversal_result {
+    // Number of nodes passed to the visitor.
+    std::size_t visited;
+    // Whether the visitor stopped the traversal.
+    bool stopped;
+};
+
+// Edge extractor for node types with a `ptr_fields` specialisation.
+template <typename T>
+struct ptr_field_edges {
+    template <typename F>
+    void operator ()(ptr<T> node, F&& f) const {
+        ptr_fields<T>::visit(*node, [&f](ptr<T>& field) { f(field); });
+    }
+};
+
+namespace detail {
+    // Set of visited nodes, split into shards with a lock each so that
+    // threads inserting different nodes rarely contend.
+    template <typename T>
+    class sharded_ptr_set {
+    public:
+        sharded_ptr_set() : shards(new padded<shard>[shard_count]) { }
+
+        // Whether `p` was newly inserted.
+        bool insert(ptr<T> p) {
+            auto& s = shards[shard_of(p)].value;
+            std::lock_guard<std::mutex> lock(s.mutex);
+            return s.set.insert(p).second;
+        }
+
+    private:
+        static constexpr std::size_t shard_bits = 6;
+        static constexpr std::size_t shard_count = std::size_t(1) << shard_bits;
+
+        struct shard {
+            std::mutex mutex;
+            std::unordered_set<ptr<T>> set;
+        };
+
+        static std::size_t shard_of(ptr<T> p) noexcept {
+            auto const word = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(p.get()));
+            return static_cast<std::size_t>((word * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - shard_bits));
+        }
+
+        std::unique_ptr<padded<shard>[]> shards;
+    };
+
+    // Expands one chunk of a BFS frontier into a private part of the next.
+    template <typename T, typename Edges, typename Visitor>
+    struct bfs_chunk : task {
+        struct shared_state {
+            Edges const& edges;
+            Visitor const& visit;
+            sharded_ptr_set<T>& visited;
+            std::atomic<bool>& stop;
+            std::size_t depth;
+        };
+
+        bfs_chunk(shared_state const& state, ptr<T> const* first, ptr<T> const* last)
+            : state(state), first(first), last(last), visited(0) { }
+
+        void run(fork_join_pool&) override {
+            auto const n = static_cast<std::size_t>(last - first);
+            for (std::size_t i = 0; i != n; ++i) {
+                if (state.stop.load(std::memory_order_relaxed)) return;
+                if (i + default_prefetch_distance < n) prefetch(first[i + default_prefetch_distance].get());
+                auto const node = first[i];
+                ++visited;
+                if (not state.visit(node, state.depth)) {
+                    state.stop.store(true, std::memory_order_relaxed);
+                    return;
+                }
+                state.edges(node, [this](ptr<T> target) {
+                    if (target != nullptr and state.visited.insert(target)) next.push_back(target);
+                });
+            }
+        }
+
+        shared_state const& state;
+        ptr<T> const* first;
+        ptr<T> const* last;
+        std::size_t visited;
+        std::vector<ptr<T>> next;
+    };
+
+    template <typename Chunk>
+    struct bfs_level : task {
+        explicit bfs_level(std::deque<Chunk>& chunks) : chunks(chunks) { }
+
+        void run(fork_join_pool& pool) override {
+            for (auto& chunk : chunks) pool.spawn(raw_ptr(&chunk));
+            pool.sync();
+        }
+
+        std::deque<Chunk>& chunks;
+    };
+} // namespace detail
+
+// Level-synchronous parallel breadth-first traversal from the nodes in
+// `[first, last)` on the workers of `pool`. Each frontier is split into
+// chunks that are expanded in parallel, prefetching the nodes ahead in the
+// frontier. `edges` and `visit` are called concurrently from several
+// threads; nodes of one depth are visited in no particular order.
+template <typename T, typename Edges, typename Visitor>
+traversal_result breadth_first(fork_join_pool& pool, ptr<T> const* first, ptr<T> const* last,
+        Edges const& edges, Visitor const& visit, std::size_t chunk_size = 256) {
+    using chunk = detail::bfs_chunk<T, Edges, Visitor>;
+
+    detail::sharded_ptr_set<T> visited;
+    std::atomic<bool> stop(false);
+    traversal_result result = { 0, false };
+
+    std::vector<ptr<T>> frontier;
+    for (; first != last; ++first) {
+        if (*first != nullptr and visited.insert(*first)) frontier.push_back(*first);
+    }
+
+    for (std::size_t depth = 0; not frontier.empty(); ++depth) {
+        typename chunk::shared_state const state = { edges, visit, visited, stop, depth };
+        // Tasks cannot move, so they are kept in a deque.
+        std::deque<chunk> chunks;
+        for (std::size_t begin = 0; begin < frontier.size(); begin += chunk_size) {
+            auto const end = std::min(frontier.size(), begin + chunk_size);
+            chunks.emplace_back(state, frontier.data() + begin, frontier.data() + end);
+        }
+        detail::bfs_level<chunk> level(chunks);
+        pool.run(raw_ptr(&level));
+
+        std::vector<ptr<T>> next;
+        for (auto& c : chunks) {
+            result.visited += c.visited;
+            next.insert(next.end(), c.next.begin(), c.next.end());
+        }
+        if (stop.load(std::memory_order_relaxed)) {
+            result.stopped = true;
+            break;
+        }
+        frontier.swap(next);
+    }
+    return result;
+}
+
+template <typename T, typename Edges, typename Visitor>
+traversal_result breadth_first(fork_join_pool& pool, ptr<T> root, Edges const& edges, Visitor const& visit) {
+    return breadth_first(pool, &root, &root + 1, edges, visit);
+}
+
+// Sequential depth-first traversal in preorder; `depth` is the length of the
+// path to a node in the depth-first tree.
+template <typename T, typename Edges, typename Visitor>
+traversal_result depth_first(ptr<T> root, Edges const& edges, Visitor&& visit) {
+    traversal_result result = { 0, false };
+    if (root == nullptr) return result;
+
+    std::unordered_set<ptr<T>> visited;
+    std::vector<std::pair<ptr<T>, std::size_t>> stack = { { root, 0 } };
+    std::vector<ptr<T>> targets;
+    while (not stack.empty()) {
+        auto const node = stack.back().first;
+        auto const depth = stack.back().second;
+        stack.pop_back();
+        // A node can be on the stack several times before it is visited.
+        if (not visited.insert(node).second) continue;
+        ++result.visited;
+        if (not visit(node, depth)) {
+            result.stopped = true;
+            break;
+        }
+
+        targets.clear();
+        edges(node, [&](ptr<T> target) {
+            if (target != nullptr and visited.count(target) == 0) targets.push_back(target);
+        });
+        // Pushed in reverse so that the first edge is explored first.
+        for (auto t = targets.rbegin(); t != targets.rend(); ++t) {
+            detail::prefetch(t->get());
+            stack.emplace_back(*t, depth + 1);
+        }
+    }
+    return result;
+}
+
+} // namespace base
+
+#endif // ndef BASE_GRAPH_TRAVERSAL_HPP
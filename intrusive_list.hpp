@@ -0,0 +1,224 @@
+#ifndef BASE_INTRUSIVE_LIST_HPP
+#define BASE_INTRUSIVE_LIST_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include "ptr.hpp"
+
+// Singly linked lists whose links live in the elements themselves, e.g. for
+// free lists and wait queues: no operation allocates, and an element can be
+// in at most one list per hook at a time. The lists never own their
+// elements.
+
+namespace base {
+
+// Single-threaded list linked through the `ptr<T>` member `Next`, with O(1)
+// insertion at both ends, removal at the front and splicing of whole lists.
+template <typename T, ptr<T> T::* Next>
+class intrusive_slist {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T*;
+        using reference = T&;
+
+        iterator() noexcept : current(nullptr) { }
+
+        T& operator *() const noexcept { return *current; }
+        T* operator ->() const noexcept { return current.get(); }
+
+        iterator& operator ++() noexcept {
+            current = (*current).*Next;
+            return *this;
+        }
+
+        iterator operator ++(int) noexcept {
+            auto const copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        friend bool operator ==(iterator lhs, iterator rhs) noexcept { return lhs.current == rhs.current; }
+        friend bool operator !=(iterator lhs, iterator rhs) noexcept { return lhs.current != rhs.current; }
+
+    private:
+        friend class intrusive_slist;
+
+        explicit iterator(ptr<T> p) noexcept : current(p) { }
+
+        ptr<T> current;
+    };
+
+    intrusive_slist() noexcept : head(nullptr), tail(nullptr) { }
+
+    intrusive_slist(intrusive_slist const&) = delete;
+    intrusive_slist& operator =(intrusive_slist const&) = delete;
+
+    intrusive_slist(intrusive_slist&& other) noexcept : head(other.head), tail(other.tail) {
+        other.clear();
+    }
+
+    intrusive_slist& operator =(intrusive_slist&& other) noexcept {
+        head = other.head;
+        tail = other.tail;
+        other.clear();
+        return *this;
+    }
+
+    bool empty() const noexcept { return head == nullptr; }
+
+    ptr<T> front() const noexcept { return head; }
+    ptr<T> back() const noexcept { return tail; }
+
+    void push_front(ptr<T> p) noexcept {
+        (*p).*Next = head;
+        head = p;
+        if (tail == nullptr) tail = p;
+    }
+
+    void push_back(ptr<T> p) noexcept {
+        (*p).*Next = nullptr;
+        if (tail == nullptr) head = p; else (*tail).*Next = p;
+        tail = p;
+    }
+
+    // Returns `nullptr` if the list is empty.
+    ptr<T> pop_front() noexcept {
+        auto const p = head;
+        if (p != nullptr) {
+            head = (*p).*Next;
+            if (head == nullptr) tail = nullptr;
+        }
+        return p;
+    }
+
+    // Moves all elements of `other` to the front of this list.
+    void splice_front(intrusive_slist& other) noexcept {
+        if (other.empty()) return;
+        (*other.tail).*Next = head;
+        if (tail == nullptr) tail = other.tail;
+        head = other.head;
+        other.clear();
+    }
+
+    // Moves all elements of `other` to the back of this list.
+    void splice_back(intrusive_slist& other) noexcept {
+        if (other.empty()) return;
+        if (tail == nullptr) head = other.head; else (*tail).*Next = other.head;
+        tail = other.tail;
+        other.clear();
+    }
+
+    // Forgets all elements; their links are left as they are.
+    void clear() noexcept { head = tail = nullptr; }
+
+    iterator begin() const noexcept { return iterator(head); }
+    iterator end() const noexcept { return iterator(); }
+
+private:
+    ptr<T> head;
+    ptr<T> tail;
+};
+
+// Lock-free (Treiber) stack linked through the `std::atomic<ptr<T>>` member
+// `Next`; the link is atomic because a popping thread may read it while the
+// element is popped and pushed again elsewhere. Against the ABA problem, the
+// head carries a 16-bit modification counter in the address bits above 48,
+// which are zero for user-space pointers on x86-64 and AArch64. Popped
+// elements must stay allocated (for instance in a pool) as long as other
+// threads may still pop, since a racing `pop` can read their link.
+template <typename T, std::atomic<ptr<T>> T::* Next>
+class lockfree_stack {
+public:
+    lockfree_stack() noexcept : head(0) { }
+
+    lockfree_stack(lockfree_stack const&) = delete;
+    lockfree_stack& operator =(lockfree_stack const&) = delete;
+
+    bool empty() const noexcept { return address(head.load(std::memory_order_relaxed)) == nullptr; }
+
+    void push(ptr<T> p) noexcept { push_chain(p, p); }
+
+    // Pushes the chain `first` ... `last`, already linked through `Next`,
+    // with a single CAS; `first` ends up on top.
+    void push_chain(ptr<T> first, ptr<T> last) noexcept {
+        auto old = head.load(std::memory_order_relaxed);
+        do {
+            ((*last).*Next).store(address(old), std::memory_order_relaxed);
+        } while (not head.compare_exchange_weak(old, pack(first, old),
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // Pushes all elements of `list`, in order, and leaves it empty.
+    template <ptr<T> T::* ListNext>
+    void push_chain(intrusive_slist<T, ListNext>& list) noexcept {
+        if (list.empty()) return;
+        for (auto p = list.front(); p != list.back(); p = (*p).*ListNext) {
+            ((*p).*Next).store((*p).*ListNext, std::memory_order_relaxed);
+        }
+        push_chain(list.front(), list.back());
+        list.clear();
+    }
+
+    // Returns `nullptr` if the stack is empty.
+    ptr<T> pop() noexcept {
+        auto old = head.load(std::memory_order_acquire);
+        for (;;) {
+            auto const top = address(old);
+            if (top == nullptr) return nullptr;
+            auto const next = ((*top).*Next).load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old, pack(next, old),
+                    std::memory_order_acquire, std::memory_order_acquire)) {
+                return top;
+            }
+        }
+    }
+
+    // Takes the whole stack at once; returns its top element, from
+    // which the others are linked through `Next`, or `nullptr`.
+    ptr<T> pop_all() noexcept {
+        auto old = head.load(std::memory_order_relaxed);
+        while (not head.compare_exchange_weak(old, pack(nullptr, old),
+            std::memory_order_acquire, std::memory_order_relaxed)) { }
+        return address(old);
+    }
+
+private:
+    static_assert(sizeof(std::uintptr_t) == 8, "Tagged heads need 64-bit pointers");
+
+    static constexpr unsigned address_bits = 48;
+
+    static ptr<T> address(std::uint64_t word) noexcept {
+        auto const mask = (std::uint64_t(1) << address_bits) - 1;
+        return raw_ptr(reinterpret_cast<T*>(static_cast<std::uintptr_t>(word & mask)));
+    }
+
+    // Whether `address` gives back `p`: the counter takes the top 16 bits,
+    // so only the canonical lower half (user space on x86-64 and AArch64)
+    // can be stored.
+    static bool packable(ptr<T> p) noexcept {
+        return reinterpret_cast<std::uintptr_t>(p.get()) >> address_bits == 0;
+    }
+
+    // `p` with the counter of `old` incremented.
+    static std::uint64_t pack(ptr<T> p, std::uint64_t old) noexcept {
+        assert(packable(p) and "address does not fit in 48 bits");
+        auto const counter = (old >> address_bits) + 1;
+        return counter << address_bits | reinterpret_cast<std::uintptr_t>(p.get());
+    }
+
+    std::atomic<std::uint64_t> head;
+};
+
+template <typename T, std::atomic<ptr<T>> T::* Next>
+constexpr unsigned lockfree_stack<T, Next>::address_bits;
+
+} // namespace base
+
+#endif // ndef BASE_INTRUSIVE_LIST_HPP
@@ -0,0 +1,18 @@
+#ifndef BASE_IO_ERROR_HPP
+#define BASE_IO_ERROR_HPP
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+
+namespace base {
+namespace detail {
+    // Exception for a failed system call on `what`, carrying the current
+    // `errno`.
+    inline std::system_error io_error(std::string const& what) {
+        return std::system_error(errno, std::generic_category(), what);
+    }
+} // namespace detail
+} // namespace base
+
+#endif // ndef BASE_IO_ERROR_HPP
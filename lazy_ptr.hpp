@@ -0,0 +1,120 @@
+#ifndef BASE_LAZY_PTR_HPP
+#define BASE_LAZY_PTR_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "ptr.hpp"
+
+namespace base {
+
+// Pointer that holds either a resolved `ptr<T>` or the ID of an object that
+// has not been loaded yet, in a single word: IDs are stored shifted left by
+// one with the low bit set, which no suitably aligned `T*` has. The first
+// `get(resolver)` calls `resolver(id)`, which must return the object's
+// `ptr<T>` (or `nullptr` if there is none), and atomically patches the word
+// with the result. Afterwards, dereferencing costs a load and a bit test.
+// Resolvers with state, such as a cache or a loader, are passed to `get` so
+// that the pointer stays one word; `get()`, `*` and `->` use a
+// value-initialised `Resolver` and suit stateless ones.
+//
+// `Resolver` should return the same object for the same ID: if several
+// threads race to resolve one `lazy_ptr`, each calls the resolver but only
+// the first result is stored, and all of them return it.
+template <typename T, typename Resolver>
+class lazy_ptr {
+public:
+    using id_type = std::uintptr_t;
+    using pointer = T*;
+    using reference = T&;
+
+    static constexpr id_type max_id = ~id_type() >> 1;
+
+    constexpr lazy_ptr() noexcept : word(0) { }
+
+    constexpr lazy_ptr(std::nullptr_t) noexcept : word(0) { }
+
+    lazy_ptr(ptr<T> p) noexcept : word(to_word(p)) { }
+
+    lazy_ptr(lazy_ptr const& other) noexcept
+        : word(other.word.load(std::memory_order_acquire)) { }
+
+    lazy_ptr& operator =(lazy_ptr const& other) noexcept {
+        word.store(other.word.load(std::memory_order_acquire), std::memory_order_release);
+        return *this;
+    }
+
+    // Requires `id <= max_id`.
+    static lazy_ptr unresolved(id_type id) noexcept {
+        return lazy_ptr(id << 1 | tag);
+    }
+
+    bool resolved() const noexcept {
+        return (word.load(std::memory_order_acquire) & tag) == 0;
+    }
+
+    // Requires `not resolved()`.
+    id_type id() const noexcept {
+        return word.load(std::memory_order_acquire) >> 1;
+    }
+
+    // Resolved pointer, or `nullptr` if not yet resolved. Never resolves.
+    ptr<T> peek() const noexcept {
+        auto const w = word.load(std::memory_order_acquire);
+        return w & tag ? nullptr : from_word(w);
+    }
+
+    ptr<T> get(Resolver& resolver) const {
+        auto const w = word.load(std::memory_order_acquire);
+        return w & tag ? resolve(w, resolver) : from_word(w);
+    }
+
+    ptr<T> get() const {
+        auto const w = word.load(std::memory_order_acquire);
+        if ((w & tag) == 0) return from_word(w);
+        Resolver resolver{};
+        return resolve(w, resolver);
+    }
+
+    reference operator *() const { return *get(); }
+
+    pointer operator ->() const { return get().get(); }
+
+    operator ptr<T>() const { return get(); }
+
+private:
+    static constexpr id_type tag = 1;
+
+    explicit lazy_ptr(id_type word) noexcept : word(word) { }
+
+    static id_type to_word(ptr<T> p) noexcept {
+        static_assert(alignof(T) > 1, "lazy_ptr needs a free low pointer bit");
+        return reinterpret_cast<id_type>(p.get());
+    }
+
+    static ptr<T> from_word(id_type w) noexcept {
+        return raw_ptr(reinterpret_cast<pointer>(w));
+    }
+
+    ptr<T> resolve(id_type w, Resolver& resolver) const {
+        ptr<T> const p = resolver(w >> 1);
+        if (word.compare_exchange_strong(w, to_word(p),
+                std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return p;
+        }
+        // Lost the race: `w` now holds the winner's word.
+        return w & tag ? resolve(w, resolver) : from_word(w);
+    }
+
+    mutable std::atomic<id_type> word;
+};
+
+template <typename T, typename Resolver>
+constexpr typename lazy_ptr<T, Resolver>::id_type lazy_ptr<T, Resolver>::max_id;
+
+template <typename T, typename Resolver>
+constexpr typename lazy_ptr<T, Resolver>::id_type lazy_ptr<T, Resolver>::tag;
+
+} // namespace base
+
+#endif // ndef BASE_LAZY_PTR_HPP
@@ -0,0 +1,399 @@
+#ifndef BASE_PACKED_PTR_ARRAY_HPP
+#define BASE_PACKED_PTR_ARRAY_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+#include "cpu_features.hpp"
+#include "ptr.hpp"
+
+// Arrays of `ptr` stored in 6 bytes per entry instead of 8, for large arrays
+// of pointers such as edge lists, where memory and bandwidth matter more than
+// the few instructions it takes to reassemble a pointer. Entries keep the low
+// 48 bits of an address and restore the rest by sign extension, so stored
+// addresses must be canonical 48-bit ones, as on x86-64 with four-level
+// paging and on AArch64 with 48-bit virtual addresses. Addresses from
+// five-level paging (LA57), tagged pointers and pointers signed with
+// pointer authentication do not fit; storing one is caught by an assertion
+// in debug builds. Bulk packing and unpacking use AVX2 where the CPU
+// supports it.
+
+namespace base {
+
+namespace detail {
+    constexpr std::size_t packed_ptr_size = 6;
+
+    // The layout is little-endian everywhere; on little-endian machines an
+    // entry is read and written as a 4-byte and a 2-byte word.
+    inline std::uint64_t load_packed(unsigned char const* p) noexcept {
+#if defined(__BYTE_ORDER__) and __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        std::uint32_t low;
+        std::uint16_t high;
+        std::memcpy(&low, p, sizeof low);
+        std::memcpy(&high, p + sizeof low, sizeof high);
+        return low | std::uint64_t(high) << 32;
+#else
+        std::uint64_t word = 0;
+        for (std::size_t i = 0; i != packed_ptr_size; ++i) word |= std::uint64_t(p[i]) << (8 * i);
+        return word;
+#endif
+    }
+
+    inline void store_packed(unsigned char* p, std::uint64_t word) noexcept {
+#if defined(__BYTE_ORDER__) and __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        auto const low = static_cast<std::uint32_t>(word);
+        auto const high = static_cast<std::uint16_t>(word >> 32);
+        std::memcpy(p, &low, sizeof low);
+        std::memcpy(p + sizeof low, &high, sizeof high);
+#else
+        for (std::size_t i = 0; i != packed_ptr_size; ++i) p[i] = static_cast<unsigned char>(word >> (8 * i));
+#endif
+    }
+
+    // Restores the high 16 bits of a canonical address from bit 47.
+    inline std::uintptr_t sign_extend_packed(std::uint64_t word) noexcept {
+        return static_cast<std::uintptr_t>(word & (std::uint64_t(1) << 47) ? word | ~std::uint64_t(0) << 48 : word);
+    }
+
+    // Whether `p` survives packing and unpacking.
+    template <typename T>
+    inline bool packable(ptr<T> p) noexcept {
+        auto const word = reinterpret_cast<std::uintptr_t>(p.get());
+        return sign_extend_packed(word & ((std::uint64_t(1) << 48) - 1)) == word;
+    }
+
+    template <typename T>
+    inline ptr<T> unpack_ptr(unsigned char const* p) noexcept {
+        return raw_ptr(reinterpret_cast<T*>(sign_extend_packed(load_packed(p))));
+    }
+
+    template <typename T>
+    inline void pack_ptr(unsigned char* p, ptr<T> value) noexcept {
+        assert(packable(value) and "address does not fit in 48 bits");
+        store_packed(p, reinterpret_cast<std::uintptr_t>(value.get()));
+    }
+
+    // Kernels return the number of leading entries they have handled; the
+    // caller finishes the remainder with scalar code.
+
+#if BASE_SIMD_X86
+    // Four pointers at a time: in each 128-bit lane, the low six bytes of
+    // both words are moved together, then the lanes are joined.
+    BASE_TARGET("avx2")
+    inline std::size_t pack_avx2(std::uintptr_t const* words, std::size_t n, unsigned char* out) noexcept {
+        auto const bytes = _mm256_setr_epi8(
+            0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1,
+            0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1);
+        auto const lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(words + i));
+            v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, bytes), lanes);
+            auto const dst = out + packed_ptr_size * i;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(v));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 16), _mm256_extracti128_si256(v, 1));
+        }
+        return i;
+    }
+
+    // The reverse, reading 32 bytes for every 24 bytes of entries, so it
+    // stops while at least 8 more bytes are readable after the entries. The
+    // top byte of each entry is copied into the two high bytes of its word,
+    // whose 16-bit lane an arithmetic shift then fills with the sign.
+    BASE_TARGET("avx2")
+    inline std::size_t unpack_avx2(unsigned char const* in, std::size_t n, std::size_t readable,
+            std::uintptr_t* words) noexcept {
+        auto const lanes = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+        auto const bytes = _mm256_setr_epi8(
+            0, 1, 2, 3, 4, 5, 5, 5, 6, 7, 8, 9, 10, 11, 11, 11,
+            0, 1, 2, 3, 4, 5, 5, 5, 6, 7, 8, 9, 10, 11, 11, 11);
+        std::size_t i = 0;
+        for (; i + 4 <= n and packed_ptr_size * i + 32 <= readable; i += 4) {
+            auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + packed_ptr_size * i));
+            v = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(v, lanes), bytes);
+            v = _mm256_blend_epi16(v, _mm256_srai_epi16(v, 15), 0x88);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(words + i), v);
+        }
+        return i;
+    }
+#endif
+
+    inline std::size_t pack_block(simd_level level, std::uintptr_t const* words, std::size_t n,
+            unsigned char* out) noexcept {
+        switch (level) {
+#if BASE_SIMD_X86
+            case simd_level::avx512:
+            case simd_level::avx2: return pack_avx2(words, n, out);
+#endif
+            default: return 0;
+        }
+    }
+
+    inline std::size_t unpack_block(simd_level level, unsigned char const* in, std::size_t n, std::size_t readable,
+            std::uintptr_t* words) noexcept {
+        switch (level) {
+#if BASE_SIMD_X86
+            case simd_level::avx512:
+            case simd_level::avx2: return unpack_avx2(in, n, readable, words);
+#endif
+            default: return 0;
+        }
+    }
+
+    template <typename T>
+    void pack(simd_level level, ptr<T> const* first, ptr<T> const* last, unsigned char* out) noexcept {
+        static_assert(sizeof(ptr<T>) == sizeof(std::uintptr_t), "ptr must be pointer-sized");
+        auto const n = static_cast<std::size_t>(last - first);
+        for (auto p = first; p != last; ++p) assert(packable(*p) and "address does not fit in 48 bits");
+        auto i = pack_block(level, reinterpret_cast<std::uintptr_t const*>(first), n, out);
+        for (; i != n; ++i) pack_ptr(out + packed_ptr_size * i, first[i]);
+    }
+
+    // `readable` is the number of bytes that may be read from `in`, at least
+    // 6 * `n`.
+    template <typename T>
+    void unpack(simd_level level, unsigned char const* in, std::size_t n, std::size_t readable,
+            ptr<T>* out) noexcept {
+        static_assert(sizeof(ptr<T>) == sizeof(std::uintptr_t), "ptr must be pointer-sized");
+        auto i = unpack_block(level, in, n, readable, reinterpret_cast<std::uintptr_t*>(out));
+        for (; i != n; ++i) out[i] = unpack_ptr<T>(in + packed_ptr_size * i);
+    }
+} // namespace detail
+
+// Sequence of `ptr<T>` with the interface of a `std::vector` whose elements
+// are accessed through proxies, like `std::vector<bool>`: a mutable element
+// is a `reference` that converts to and assigns from `ptr<T>`, and a const
+// one is a `ptr<T>` value. Only canonical 48-bit addresses can be stored
+// (see above).
+template <typename T>
+class packed_ptr_array {
+public:
+    class reference {
+    public:
+        reference& operator =(ptr<T> value) noexcept {
+            detail::pack_ptr(position, value);
+            return *this;
+        }
+
+        reference& operator =(reference const& other) noexcept { return *this = other.get(); }
+
+        operator ptr<T>() const noexcept { return get(); }
+
+        ptr<T> get() const noexcept { return detail::unpack_ptr<T>(position); }
+
+        T& operator *() const noexcept { return *get(); }
+        T* operator ->() const noexcept { return get().get(); }
+
+        friend void swap(reference lhs, reference rhs) noexcept {
+            ptr<T> const value = lhs;
+            lhs = rhs;
+            rhs = value;
+        }
+
+        // Found only through `reference` arguments, and then compare either
+        // side as `ptr<T>`.
+        friend bool operator ==(ptr<T> lhs, ptr<T> rhs) noexcept { return lhs == rhs; }
+        friend bool operator !=(ptr<T> lhs, ptr<T> rhs) noexcept { return lhs != rhs; }
+        friend bool operator <(ptr<T> lhs, ptr<T> rhs) noexcept { return lhs < rhs; }
+        friend bool operator <=(ptr<T> lhs, ptr<T> rhs) noexcept { return lhs <= rhs; }
+        friend bool operator >(ptr<T> lhs, ptr<T> rhs) noexcept { return lhs > rhs; }
+        friend bool operator >=(ptr<T> lhs, ptr<T> rhs) noexcept { return lhs >= rhs; }
+
+    private:
+        friend class packed_ptr_array;
+
+        explicit reference(unsigned char* position) noexcept : position(position) { }
+
+        unsigned char* position;
+    };
+
+    template <typename Byte, typename Reference>
+    class basic_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = ptr<T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Reference;
+
+        basic_iterator() noexcept : position(nullptr) { }
+
+        // From `iterator` to `const_iterator`.
+        template <typename B, typename R,
+            typename = typename std::enable_if<std::is_convertible<B*, Byte*>::value>::type>
+        basic_iterator(basic_iterator<B, R> other) noexcept : position(other.position) { }
+
+        Reference operator *() const noexcept { return packed_ptr_array::at(position); }
+
+        Reference operator [](difference_type n) const noexcept { return *(*this + n); }
+
+        basic_iterator& operator ++() noexcept {
+            position += detail::packed_ptr_size;
+            return *this;
+        }
+
+        basic_iterator operator ++(int) noexcept {
+            auto const copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        basic_iterator& operator --() noexcept {
+            position -= detail::packed_ptr_size;
+            return *this;
+        }
+
+        basic_iterator operator --(int) noexcept {
+            auto const copy = *this;
+            --*this;
+            return copy;
+        }
+
+        basic_iterator& operator +=(difference_type n) noexcept {
+            position += n * static_cast<difference_type>(detail::packed_ptr_size);
+            return *this;
+        }
+
+        basic_iterator& operator -=(difference_type n) noexcept { return *this += -n; }
+
+        friend basic_iterator operator +(basic_iterator i, difference_type n) noexcept { return i += n; }
+        friend basic_iterator operator +(difference_type n, basic_iterator i) noexcept { return i += n; }
+        friend basic_iterator operator -(basic_iterator i, difference_type n) noexcept { return i -= n; }
+
+        friend difference_type operator -(basic_iterator lhs, basic_iterator rhs) noexcept {
+            return (lhs.position - rhs.position) / static_cast<difference_type>(detail::packed_ptr_size);
+        }
+
+        friend bool operator ==(basic_iterator lhs, basic_iterator rhs) noexcept { return lhs.position == rhs.position; }
+        friend bool operator !=(basic_iterator lhs, basic_iterator rhs) noexcept { return lhs.position != rhs.position; }
+        friend bool operator <(basic_iterator lhs, basic_iterator rhs) noexcept { return lhs.position < rhs.position; }
+        friend bool operator <=(basic_iterator lhs, basic_iterator rhs) noexcept { return lhs.position <= rhs.position; }
+        friend bool operator >(basic_iterator lhs, basic_iterator rhs) noexcept { return lhs.position > rhs.position; }
+        friend bool operator >=(basic_iterator lhs, basic_iterator rhs) noexcept { return lhs.position >= rhs.position; }
+
+    private:
+        friend class packed_ptr_array;
+        template <typename, typename> friend class basic_iterator;
+
+        explicit basic_iterator(Byte* position) noexcept : position(position) { }
+
+        Byte* position;
+    };
+
+    using value_type = ptr<T>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using const_reference = ptr<T>;
+    using iterator = basic_iterator<unsigned char, reference>;
+    using const_iterator = basic_iterator<unsigned char const, ptr<T>>;
+
+    packed_ptr_array() { }
+
+    // `n` null entries.
+    explicit packed_ptr_array(std::size_t n) : storage(detail::packed_ptr_size * n) { }
+
+    packed_ptr_array(std::size_t n, ptr<T> value) : storage(detail::packed_ptr_size * n) {
+        for (auto i = begin(); i != end(); ++i) *i = value;
+    }
+
+    template <typename InputIt>
+    packed_ptr_array(InputIt first, InputIt last) { assign(first, last); }
+
+    packed_ptr_array(std::initializer_list<ptr<T>> values) { assign(values.begin(), values.end()); }
+
+    // Ranges given as pointers to `ptr<T>` are packed in bulk.
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last) {
+        assign(first, last, std::is_convertible<InputIt, ptr<T> const*>());
+    }
+
+    std::size_t size() const noexcept { return storage.size() / detail::packed_ptr_size; }
+    bool empty() const noexcept { return storage.empty(); }
+    std::size_t capacity() const noexcept { return storage.capacity() / detail::packed_ptr_size; }
+
+    void reserve(std::size_t n) { storage.reserve(detail::packed_ptr_size * n); }
+    void shrink_to_fit() { storage.shrink_to_fit(); }
+    void clear() noexcept { storage.clear(); }
+
+    // New entries are null.
+    void resize(std::size_t n) { storage.resize(detail::packed_ptr_size * n); }
+
+    void push_back(ptr<T> value) {
+        unsigned char entry[detail::packed_ptr_size];
+        detail::pack_ptr(entry, value);
+        storage.insert(storage.end(), entry, entry + detail::packed_ptr_size);
+    }
+
+    void pop_back() noexcept { storage.resize(storage.size() - detail::packed_ptr_size); }
+
+    reference operator [](std::size_t i) noexcept { return at(storage.data() + detail::packed_ptr_size * i); }
+    ptr<T> operator [](std::size_t i) const noexcept { return at(storage.data() + detail::packed_ptr_size * i); }
+
+    reference front() noexcept { return (*this)[0]; }
+    ptr<T> front() const noexcept { return (*this)[0]; }
+    reference back() noexcept { return (*this)[size() - 1]; }
+    ptr<T> back() const noexcept { return (*this)[size() - 1]; }
+
+    iterator begin() noexcept { return iterator(storage.data()); }
+    iterator end() noexcept { return iterator(storage.data() + storage.size()); }
+    const_iterator begin() const noexcept { return const_iterator(storage.data()); }
+    const_iterator end() const noexcept { return const_iterator(storage.data() + storage.size()); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    // Overwrites the entries from `pos` on, which must exist, with
+    // `[first, last)`.
+    void pack(std::size_t pos, ptr<T> const* first, ptr<T> const* last) noexcept {
+        detail::pack(supported_simd_level(), first, last, storage.data() + detail::packed_ptr_size * pos);
+    }
+
+    // Copies the `n` entries from `pos` on to `out`.
+    void unpack(std::size_t pos, std::size_t n, ptr<T>* out) const noexcept {
+        auto const offset = detail::packed_ptr_size * pos;
+        detail::unpack(supported_simd_level(), storage.data() + offset, n, storage.size() - offset, out);
+    }
+
+    // The packed entries: 6 bytes each, little-endian.
+    unsigned char const* data() const noexcept { return storage.data(); }
+
+    void swap(packed_ptr_array& other) noexcept { storage.swap(other.storage); }
+
+    friend void swap(packed_ptr_array& lhs, packed_ptr_array& rhs) noexcept { lhs.swap(rhs); }
+
+    friend bool operator ==(packed_ptr_array const& lhs, packed_ptr_array const& rhs) noexcept {
+        return lhs.storage == rhs.storage;
+    }
+
+    friend bool operator !=(packed_ptr_array const& lhs, packed_ptr_array const& rhs) noexcept {
+        return lhs.storage != rhs.storage;
+    }
+
+private:
+    static reference at(unsigned char* position) noexcept { return reference(position); }
+    static ptr<T> at(unsigned char const* position) noexcept { return detail::unpack_ptr<T>(position); }
+
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last, std::true_type /* contiguous ptr<T> */) {
+        ptr<T> const* const begin = first;
+        ptr<T> const* const end = last;
+        storage.resize(detail::packed_ptr_size * static_cast<std::size_t>(end - begin));
+        pack(0, begin, end);
+    }
+
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last, std::false_type /* contiguous ptr<T> */) {
+        clear();
+        for (; first != last; ++first) push_back(*first);
+    }
+
+    std::vector<unsigned char> storage;
+};
+
+} // namespace base
+
+#endif // ndef BASE_PACKED_PTR_ARRAY_HPP
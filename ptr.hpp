@@ -1,7 +1,12 @@
 #ifndef BASE_PTR_HPP
 #define BASE_PTR_HPP
 
-#include <memory>
+#include <cstddef>
+#include "ptr_fwd.hpp"
+
+#ifdef BASE_PTR_TRACE
+#   include "ptr_trace.hpp"
+#endif
 
 namespace base {
 
@@ -20,16 +25,22 @@ public:
     friend class ptr;
 
     template <typename Other>
-    ptr(ptr<Other> const& other) noexcept : value(other.value) { }
+    constexpr ptr(ptr<Other> const& other) noexcept : value(other.value) { }
+
+    constexpr pointer get() const noexcept { return value; }
 
-    pointer get() const noexcept { return value; }
+#ifdef BASE_PTR_TRACE
+    reference operator *() const noexcept { return trace::record(value), *get(); }
 
-    reference operator *() const noexcept { return *get(); }
+    pointer operator ->() const noexcept { return trace::record(value), get(); }
+#else
+    constexpr reference operator *() const noexcept { return *get(); }
 
-    pointer operator ->() const noexcept { return get(); }
+    constexpr pointer operator ->() const noexcept { return get(); }
+#endif
 
     template <typename U>
-    friend ptr<U> raw_ptr(U*) noexcept;
+    friend constexpr ptr<U> raw_ptr(U*) noexcept;
 
 private:
     pointer value;
@@ -37,46 +48,46 @@ private:
     // We want to force users to use the builder function `raw_ptr`, rather than
     // using a converting constructor to create a `ptr` instance from a raw T*.
     // This makes it explicit that we are intentionally handling a raw pointer.
-    explicit ptr(pointer value) noexcept : value(value) { }
+    constexpr explicit ptr(pointer value) noexcept : value(value) { }
 };
 
 template <typename T>
-inline ptr<T> raw_ptr(T* value) noexcept {
+constexpr ptr<T> raw_ptr(T* value) noexcept {
     return static_cast<ptr<T>>(value);
 }
 
 template <typename T, typename U>
-inline bool operator ==(ptr<T> const& lhs, ptr<U> const& rhs) noexcept {
+constexpr bool operator ==(ptr<T> const& lhs, ptr<U> const& rhs) noexcept {
     return lhs.get() == rhs.get();
 }
 
 template <typename T>
-inline bool operator ==(ptr<T> const& lhs, std::nullptr_t) noexcept {
+constexpr bool operator ==(ptr<T> const& lhs, std::nullptr_t) noexcept {
     return lhs.get() == nullptr;
 }
 
 template <typename T>
-inline bool operator ==(std::nullptr_t, ptr<T> const& rhs) noexcept {
+constexpr bool operator ==(std::nullptr_t, ptr<T> const& rhs) noexcept {
     return rhs.get() == nullptr;
 }
 
 template <typename T, typename U>
-inline bool operator !=(ptr<T> lhs, ptr<U> rhs) noexcept {
+constexpr bool operator !=(ptr<T> lhs, ptr<U> rhs) noexcept {
     return not (lhs == rhs);
 }
 
 template <typename T>
-inline bool operator !=(ptr<T> const& lhs, std::nullptr_t) noexcept {
+constexpr bool operator !=(ptr<T> const& lhs, std::nullptr_t) noexcept {
     return lhs.get() != nullptr;
 }
 
 template <typename T>
-inline bool operator !=(std::nullptr_t, ptr<T> const& rhs) noexcept {
+constexpr bool operator !=(std::nullptr_t, ptr<T> const& rhs) noexcept {
     return rhs.get() != nullptr;
 }
 
 template <typename T, typename U>
-inline ptr<T> static_pointer_cast(ptr<U> const& p) noexcept {
+constexpr ptr<T> static_pointer_cast(ptr<U> const& p) noexcept {
     return raw_ptr(static_cast<T*>(p.get()));
 }
 
@@ -86,92 +97,70 @@ inline ptr<T> dynamic_pointer_cast(ptr<U> const& p) noexcept {
 }
 
 template <typename T, typename U>
-inline ptr<T> const_pointer_cast(ptr<U> const& p) noexcept {
+constexpr ptr<T> const_pointer_cast(ptr<U> const& p) noexcept {
     return raw_ptr(const_cast<T*>(p.get()));
 }
 
 template <typename T, typename U>
-inline bool operator <(ptr<T> const& lhs, ptr<U> const& rhs) noexcept {
+constexpr bool operator <(ptr<T> const& lhs, ptr<U> const& rhs) noexcept {
     return lhs.get() < rhs.get();
 }
 
 template <typename T>
-inline bool operator <(ptr<T> const&, std::nullptr_t) noexcept {
+constexpr bool operator <(ptr<T> const&, std::nullptr_t) noexcept {
     return false;
 }
 
 template <typename T>
-inline bool operator <(std::nullptr_t, ptr<T> const& rhs) noexcept {
+constexpr bool operator <(std::nullptr_t, ptr<T> const& rhs) noexcept {
     return rhs.get() != nullptr;
 }
 
 template <typename T, typename U>
-inline bool operator <=(ptr<T> const& lhs, ptr<U> const& rhs) noexcept {
+constexpr bool operator <=(ptr<T> const& lhs, ptr<U> const& rhs) noexcept {
     return lhs.get() <= rhs.get();
 }
 
 template <typename T>
-inline bool operator <=(ptr<T> const& lhs, std::nullptr_t) noexcept {
+constexpr bool operator <=(ptr<T> const& lhs, std::nullptr_t) noexcept {
     return lhs.get() == nullptr;
 }
 
 template <typename T>
-inline bool operator <=(std::nullptr_t, ptr<T> const&) noexcept {
+constexpr bool operator <=(std::nullptr_t, ptr<T> const&) noexcept {
     return true;
 }
 
 template <typename T, typename U>
-inline bool operator >(ptr<T> const& lhs, ptr<U> const& rhs) noexcept {
+constexpr bool operator >(ptr<T> const& lhs, ptr<U> const& rhs) noexcept {
     return lhs.get() > rhs.get();
 }
 
 template <typename T>
-inline bool operator >(ptr<T> const& lhs, std::nullptr_t) noexcept {
+constexpr bool operator >(ptr<T> const& lhs, std::nullptr_t) noexcept {
     return lhs != nullptr;
 }
 
 template <typename T>
-inline bool operator >(std::nullptr_t, ptr<T> const&) noexcept {
+constexpr bool operator >(std::nullptr_t, ptr<T> const&) noexcept {
     return false;
 }
 
 template <typename T, typename U>
-inline bool operator >=(ptr<T> const& lhs, ptr<U> const& rhs) noexcept {
+constexpr bool operator >=(ptr<T> const& lhs, ptr<U> const& rhs) noexcept {
     return lhs.get() >= rhs.get();
 }
 
 template <typename T>
-inline bool operator >=(ptr<T> const&, std::nullptr_t) noexcept {
+constexpr bool operator >=(ptr<T> const&, std::nullptr_t) noexcept {
     return true;
 }
 
 template <typename T>
-inline bool operator >=(std::nullptr_t, ptr<T> const& rhs) noexcept {
+constexpr bool operator >=(std::nullptr_t, ptr<T> const& rhs) noexcept {
     return nullptr == rhs.get();
 }
 
 } // namespace base
 
-namespace std {
-    template <typename T>
-    struct pointer_traits<base::ptr<T>> {
-        using pointer = T*;
-        using element_type = T;
-        using difference_type = ptrdiff_t;
-
-        template <typename U>
-        using rebind = base::ptr<U>;
-    };
-
-    template <typename T>
-    struct hash<base::ptr<T>> {
-        using result_type = size_t;
-        using argument_type = base::ptr<T>;
-
-        result_type operator ()(argument_type const& p) const noexcept {
-            return std::hash<typename base::ptr<T>::pointer>()(p.get());
-        }
-    };
-} // namespace std
-
 #endif // ndef BASE_PTR_HPP
@@ -0,0 +1,266 @@
+#ifndef BASE_PTR_ALGORITHM_HPP
+#define BASE_PTR_ALGORITHM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "cpu_features.hpp"
+#include "ptr.hpp"
+
+// Searching contiguous ranges of `ptr`. Since `ptr` is trivial and
+// pointer-sized, a range of them is an array of address words that can be
+// compared 2, 4 or 8 at a time with SSE2, AVX2 or AVX-512; the widest level
+// supported by the CPU is picked at run time.
+
+namespace base {
+
+namespace detail {
+    using word = std::uintptr_t;
+
+    template <typename T>
+    inline word const* words(ptr<T> const* p) noexcept {
+        static_assert(sizeof(ptr<T>) == sizeof(word) and std::is_trivial<ptr<T>>::value,
+            "ptr must be a trivial pointer-sized type");
+        return reinterpret_cast<word const*>(p);
+    }
+
+    template <typename T>
+    inline word word_of(ptr<T> p) noexcept {
+        return reinterpret_cast<word>(p.get());
+    }
+
+    // Kernels return the number of leading elements they have handled; the
+    // caller finishes the remainder with scalar code. `find_*` return the
+    // index of the first match instead, if there is one before that point.
+
+    struct block_result {
+        std::size_t done;
+        std::size_t found;
+    };
+
+#if BASE_SIMD_X86
+    BASE_TARGET("sse2")
+    inline __m128i eq64_sse2(__m128i a, __m128i b) noexcept {
+        // SSE2 has no 64-bit compare: both 32-bit halves must be equal.
+        auto const eq32 = _mm_cmpeq_epi32(a, b);
+        return _mm_and_si128(eq32, _mm_shuffle_epi32(eq32, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+
+    BASE_TARGET("sse2")
+    inline unsigned eq_mask_sse2(word const* data, __m128i key) noexcept {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data));
+        return static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(eq64_sse2(v, key))));
+    }
+
+    BASE_TARGET("avx2")
+    inline unsigned eq_mask_avx2(word const* data, __m256i key) noexcept {
+        auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data));
+        return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, key))));
+    }
+
+    BASE_TARGET("avx512f")
+    inline unsigned eq_mask_avx512(word const* data, __m512i key) noexcept {
+        return _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(data), key);
+    }
+
+    BASE_TARGET("sse2")
+    inline block_result find_sse2(word const* data, std::size_t n, word value) noexcept {
+        auto const key = _mm_set1_epi64x(static_cast<long long>(value));
+        std::size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            if (auto const mask = eq_mask_sse2(data + i, key)) return {i, i + __builtin_ctz(mask)};
+        }
+        return {i, n};
+    }
+
+    BASE_TARGET("avx2")
+    inline block_result find_avx2(word const* data, std::size_t n, word value) noexcept {
+        auto const key = _mm256_set1_epi64x(static_cast<long long>(value));
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            if (auto const mask = eq_mask_avx2(data + i, key)) return {i, i + __builtin_ctz(mask)};
+        }
+        return {i, n};
+    }
+
+    BASE_TARGET("avx512f")
+    inline block_result find_avx512(word const* data, std::size_t n, word value) noexcept {
+        auto const key = _mm512_set1_epi64(static_cast<long long>(value));
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            if (auto const mask = eq_mask_avx512(data + i, key)) return {i, i + __builtin_ctz(mask)};
+        }
+        return {i, n};
+    }
+
+    BASE_TARGET("sse2")
+    inline block_result count_sse2(word const* data, std::size_t n, word value) noexcept {
+        auto const key = _mm_set1_epi64x(static_cast<long long>(value));
+        std::size_t i = 0;
+        std::size_t count = 0;
+        for (; i + 2 <= n; i += 2) count += __builtin_popcount(eq_mask_sse2(data + i, key));
+        return {i, count};
+    }
+
+    BASE_TARGET("avx2")
+    inline block_result count_avx2(word const* data, std::size_t n, word value) noexcept {
+        auto const key = _mm256_set1_epi64x(static_cast<long long>(value));
+        std::size_t i = 0;
+        std::size_t count = 0;
+        for (; i + 4 <= n; i += 4) count += __builtin_popcount(eq_mask_avx2(data + i, key));
+        return {i, count};
+    }
+
+    BASE_TARGET("avx512f")
+    inline block_result count_avx512(word const* data, std::size_t n, word value) noexcept {
+        auto const key = _mm512_set1_epi64(static_cast<long long>(value));
+        std::size_t i = 0;
+        std::size_t count = 0;
+        for (; i + 8 <= n; i += 8) count += __builtin_popcount(eq_mask_avx512(data + i, key));
+        return {i, count};
+    }
+
+    // `found` is nonzero if any element in the handled prefix is one of the
+    // `k` needles.
+    BASE_TARGET("sse2")
+    inline block_result any_sse2(word const* data, std::size_t n, word const* needles, std::size_t k) noexcept {
+        std::size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i));
+            for (std::size_t j = 0; j != k; ++j) {
+                auto const key = _mm_set1_epi64x(static_cast<long long>(needles[j]));
+                if (_mm_movemask_pd(_mm_castsi128_pd(eq64_sse2(v, key)))) return {i, 1};
+            }
+        }
+        return {i, 0};
+    }
+
+    BASE_TARGET("avx2")
+    inline block_result any_avx2(word const* data, std::size_t n, word const* needles, std::size_t k) noexcept {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i));
+            auto hits = _mm256_setzero_si256();
+            for (std::size_t j = 0; j != k; ++j) {
+                auto const key = _mm256_set1_epi64x(static_cast<long long>(needles[j]));
+                hits = _mm256_or_si256(hits, _mm256_cmpeq_epi64(v, key));
+            }
+            if (not _mm256_testz_si256(hits, hits)) return {i, 1};
+        }
+        return {i, 0};
+    }
+
+    BASE_TARGET("avx512f")
+    inline block_result any_avx512(word const* data, std::size_t n, word const* needles, std::size_t k) noexcept {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            auto const v = _mm512_loadu_si512(data + i);
+            __mmask8 hits = 0;
+            for (std::size_t j = 0; j != k; ++j) {
+                hits |= _mm512_cmpeq_epi64_mask(v, _mm512_set1_epi64(static_cast<long long>(needles[j])));
+            }
+            if (hits) return {i, 1};
+        }
+        return {i, 0};
+    }
+#endif
+
+    inline block_result find_block(simd_level level, word const* data, std::size_t n, word value) noexcept {
+        switch (level) {
+#if BASE_SIMD_X86
+            case simd_level::avx512: return find_avx512(data, n, value);
+            case simd_level::avx2: return find_avx2(data, n, value);
+            case simd_level::sse2: return find_sse2(data, n, value);
+#endif
+            default: return {0, n};
+        }
+    }
+
+    inline block_result count_block(simd_level level, word const* data, std::size_t n, word value) noexcept {
+        switch (level) {
+#if BASE_SIMD_X86
+            case simd_level::avx512: return count_avx512(data, n, value);
+            case simd_level::avx2: return count_avx2(data, n, value);
+            case simd_level::sse2: return count_sse2(data, n, value);
+#endif
+            default: return {0, 0};
+        }
+    }
+
+    inline block_result any_block(simd_level level, word const* data, std::size_t n,
+            word const* needles, std::size_t k) noexcept {
+        switch (level) {
+#if BASE_SIMD_X86
+            case simd_level::avx512: return any_avx512(data, n, needles, k);
+            case simd_level::avx2: return any_avx2(data, n, needles, k);
+            case simd_level::sse2: return any_sse2(data, n, needles, k);
+#endif
+            default: return {0, 0};
+        }
+    }
+
+    template <typename T>
+    ptr<T> const* find(simd_level level, ptr<T> const* first, ptr<T> const* last, ptr<T> value) noexcept {
+        auto const n = static_cast<std::size_t>(last - first);
+        auto const block = find_block(level, words(first), n, word_of(value));
+        if (block.found != n) return first + block.found;
+        for (auto p = first + block.done; p != last; ++p) {
+            if (*p == value) return p;
+        }
+        return last;
+    }
+
+    template <typename T>
+    std::size_t count(simd_level level, ptr<T> const* first, ptr<T> const* last, ptr<T> value) noexcept {
+        auto const n = static_cast<std::size_t>(last - first);
+        auto const block = count_block(level, words(first), n, word_of(value));
+        auto result = block.found;
+        for (auto p = first + block.done; p != last; ++p) result += *p == value;
+        return result;
+    }
+
+    template <typename T>
+    bool contains_any(simd_level level, ptr<T> const* first, ptr<T> const* last,
+            ptr<T> const* values_first, ptr<T> const* values_last) noexcept {
+        auto const n = static_cast<std::size_t>(last - first);
+        auto const k = static_cast<std::size_t>(values_last - values_first);
+        if (k == 0) return false;
+        auto const block = any_block(level, words(first), n, words(values_first), k);
+        if (block.found) return true;
+        for (auto p = first + block.done; p != last; ++p) {
+            for (auto v = values_first; v != values_last; ++v) {
+                if (*p == *v) return true;
+            }
+        }
+        return false;
+    }
+} // namespace detail
+
+// First element of `[first, last)` equal to `value`, or `last`.
+template <typename T>
+inline ptr<T> const* find(ptr<T> const* first, ptr<T> const* last, ptr<T> value) noexcept {
+    return detail::find(supported_simd_level(), first, last, value);
+}
+
+template <typename T>
+inline ptr<T> const* find_null(ptr<T> const* first, ptr<T> const* last) noexcept {
+    return detail::find(supported_simd_level(), first, last, ptr<T>(nullptr));
+}
+
+template <typename T>
+inline std::size_t count(ptr<T> const* first, ptr<T> const* last, ptr<T> value) noexcept {
+    return detail::count(supported_simd_level(), first, last, value);
+}
+
+// Whether `[first, last)` contains any of the values in
+// `[values_first, values_last)`. Every element is compared with every value,
+// so this is meant for a handful of values.
+template <typename T>
+inline bool contains_any(ptr<T> const* first, ptr<T> const* last,
+        ptr<T> const* values_first, ptr<T> const* values_last) noexcept {
+    return detail::contains_any(supported_simd_level(), first, last, values_first, values_last);
+}
+
+} // namespace base
+
+#endif // ndef BASE_PTR_ALGORITHM_HPP
@@ -0,0 +1,25 @@
+#ifndef BASE_PTR_FIELDS_HPP
+#define BASE_PTR_FIELDS_HPP
+
+#include "ptr.hpp"
+
+namespace base {
+
+// Reflection hook for graphs of `ptr`-linked objects. Generic graph utilities
+// (serialisation, relocation, traversal) need to enumerate the `ptr<T>`
+// fields of a node. Specialise this template for each node type `T`:
+//
+//     template <>
+//     struct ptr_fields<node> {
+//         template <typename F>
+//         static void visit(node& n, F&& f) { f(n.left); f(n.right); }
+//     };
+//
+// `visit` must call `f` with an lvalue `ptr<T>&` for every such field; the
+// callee may read and overwrite it.
+template <typename T>
+struct ptr_fields;
+
+} // namespace base
+
+#endif // ndef BASE_PTR_FIELDS_HPP
@@ -0,0 +1,11 @@
+#ifndef BASE_PTR_FWD_HPP
+#define BASE_PTR_FWD_HPP
+
+namespace base {
+
+template <typename T>
+class ptr;
+
+} // namespace base
+
+#endif // ndef BASE_PTR_FWD_HPP
@@ -0,0 +1,234 @@
+#ifndef BASE_PTR_INTERNER_HPP
+#define BASE_PTR_INTERNER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ptr.hpp"
+
+namespace base {
+
+// Maps each distinct `ptr<T>` to a dense ID in [0, size()), in order of first
+// interning, so that sets of pointers can be stored as `ptr_bitset`s. Lookup
+// is an open-addressing hash table with linear probing, kept at most half
+// full; IDs map back to pointers through a plain array.
+template <typename T>
+class ptr_interner {
+public:
+    using id_type = std::uint32_t;
+
+    static constexpr id_type npos = ~id_type();
+
+    ptr_interner() : slots(min_capacity, slot{nullptr, npos}) { }
+
+    // ID of `p`, assigning the next one if `p` has not been interned yet.
+    id_type intern(ptr<T> p) {
+        if (2 * (pointers.size() + 1) > slots.size()) rehash(2 * slots.size());
+        auto& s = slots[probe(p)];
+        if (s.id == npos) {
+            s = slot{p, static_cast<id_type>(pointers.size())};
+            pointers.push_back(p);
+        }
+        return s.id;
+    }
+
+    // ID of `p`, or `npos` if it has not been interned.
+    id_type find(ptr<T> p) const noexcept {
+        return slots[probe(p)].id;
+    }
+
+    bool contains(ptr<T> p) const noexcept { return find(p) != npos; }
+
+    ptr<T> operator [](id_type id) const noexcept { return pointers[id]; }
+
+    std::size_t size() const noexcept { return pointers.size(); }
+
+    bool empty() const noexcept { return pointers.empty(); }
+
+    void reserve(std::size_t n) {
+        pointers.reserve(n);
+        std::size_t capacity = slots.size();
+        while (capacity < 2 * n) capacity *= 2;
+        if (capacity != slots.size()) rehash(capacity);
+    }
+
+    void clear() noexcept {
+        std::fill(slots.begin(), slots.end(), slot{nullptr, npos});
+        pointers.clear();
+    }
+
+    // Interned pointers, indexed by ID.
+    ptr<T> const* begin() const noexcept { return pointers.data(); }
+    ptr<T> const* end() const noexcept { return pointers.data() + pointers.size(); }
+
+private:
+    static constexpr std::size_t min_capacity = 16;
+
+    struct slot {
+        ptr<T> key;
+        id_type id;
+    };
+
+    // Fibonacci hashing: the high bits of the product depend on all address
+    // bits, so the alignment bits being always zero does not matter.
+    std::size_t home(ptr<T> p) const noexcept {
+        auto const word = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(p.get()));
+        return static_cast<std::size_t>((word * UINT64_C(0x9E3779B97F4A7C15)) >> shift);
+    }
+
+    // Index of the slot holding `p`, or of the empty slot where it belongs.
+    std::size_t probe(ptr<T> p) const noexcept {
+        auto const mask = slots.size() - 1;
+        auto i = home(p);
+        while (slots[i].id != npos and slots[i].key != p) i = (i + 1) & mask;
+        return i;
+    }
+
+    void rehash(std::size_t capacity) {
+        slots.assign(capacity, slot{nullptr, npos});
+        shift = 64;
+        for (auto c = capacity; c > 1; c >>= 1) --shift;
+        for (id_type id = 0; id != pointers.size(); ++id) slots[probe(pointers[id])] = slot{pointers[id], id};
+    }
+
+    std::vector<slot> slots;
+    std::vector<ptr<T>> pointers;
+    unsigned shift = 60;
+};
+
+template <typename T>
+constexpr typename ptr_interner<T>::id_type ptr_interner<T>::npos;
+
+template <typename T>
+constexpr std::size_t ptr_interner<T>::min_capacity;
+
+// Set of dense IDs (typically from a `ptr_interner`), one bit per ID. Set
+// operations work a 64-bit word at a time. Bits past `size()` are always
+// zero; the binary operations treat the shorter operand as zero-extended.
+class ptr_bitset {
+public:
+    using word_type = std::uint64_t;
+
+    static constexpr std::size_t word_bits = 64;
+
+    ptr_bitset() = default;
+
+    explicit ptr_bitset(std::size_t size) : words((size + word_bits - 1) / word_bits), bits(size) { }
+
+    // Number of representable IDs; `set` grows it as needed.
+    std::size_t size() const noexcept { return bits; }
+
+    void resize(std::size_t size) {
+        words.resize((size + word_bits - 1) / word_bits);
+        bits = size;
+        clear_tail();
+    }
+
+    bool test(std::size_t id) const noexcept {
+        return id < bits and (words[id / word_bits] >> id % word_bits & 1);
+    }
+
+    void set(std::size_t id) {
+        if (id >= bits) resize(id + 1);
+        words[id / word_bits] |= word_type(1) << id % word_bits;
+    }
+
+    void reset(std::size_t id) noexcept {
+        if (id < bits) words[id / word_bits] &= ~(word_type(1) << id % word_bits);
+    }
+
+    void clear() noexcept { std::fill(words.begin(), words.end(), 0); }
+
+    std::size_t count() const noexcept {
+        std::size_t result = 0;
+        for (auto w : words) result += popcount(w);
+        return result;
+    }
+
+    bool any() const noexcept {
+        return std::find_if(words.begin(), words.end(), [](word_type w) { return w != 0; }) != words.end();
+    }
+
+    bool none() const noexcept { return not any(); }
+
+    // Calls `f(id)` for every ID in the set, in ascending order.
+    template <typename F>
+    void for_each(F f) const {
+        for (std::size_t i = 0; i != words.size(); ++i) {
+            for (auto w = words[i]; w != 0; w &= w - 1) f(i * word_bits + ctz(w));
+        }
+    }
+
+    ptr_bitset& operator |=(ptr_bitset const& other) {
+        if (other.bits > bits) resize(other.bits);
+        for (std::size_t i = 0; i != other.words.size(); ++i) words[i] |= other.words[i];
+        return *this;
+    }
+
+    ptr_bitset& operator &=(ptr_bitset const& other) noexcept {
+        auto const common = std::min(words.size(), other.words.size());
+        for (std::size_t i = 0; i != common; ++i) words[i] &= other.words[i];
+        std::fill(words.begin() + common, words.end(), 0);
+        return *this;
+    }
+
+    // Set difference.
+    ptr_bitset& operator -=(ptr_bitset const& other) noexcept {
+        auto const common = std::min(words.size(), other.words.size());
+        for (std::size_t i = 0; i != common; ++i) words[i] &= ~other.words[i];
+        return *this;
+    }
+
+    friend ptr_bitset operator |(ptr_bitset lhs, ptr_bitset const& rhs) { return lhs |= rhs; }
+
+    friend ptr_bitset operator &(ptr_bitset lhs, ptr_bitset const& rhs) { return lhs &= rhs; }
+
+    friend ptr_bitset operator -(ptr_bitset lhs, ptr_bitset const& rhs) { return lhs -= rhs; }
+
+    // Equal if they contain the same IDs, regardless of `size()`.
+    friend bool operator ==(ptr_bitset const& lhs, ptr_bitset const& rhs) noexcept {
+        auto const& shorter = lhs.words.size() < rhs.words.size() ? lhs.words : rhs.words;
+        auto const& longer = lhs.words.size() < rhs.words.size() ? rhs.words : lhs.words;
+        return std::equal(shorter.begin(), shorter.end(), longer.begin()) and
+            std::all_of(longer.begin() + shorter.size(), longer.end(), [](word_type w) { return w == 0; });
+    }
+
+    friend bool operator !=(ptr_bitset const& lhs, ptr_bitset const& rhs) noexcept {
+        return not (lhs == rhs);
+    }
+
+    word_type const* data() const noexcept { return words.data(); }
+
+private:
+    static std::size_t popcount(word_type w) noexcept {
+#ifdef __GNUC__
+        return static_cast<std::size_t>(__builtin_popcountll(w));
+#else
+        std::size_t n = 0;
+        for (; w != 0; w &= w - 1) ++n;
+        return n;
+#endif
+    }
+
+    static std::size_t ctz(word_type w) noexcept {
+#ifdef __GNUC__
+        return static_cast<std::size_t>(__builtin_ctzll(w));
+#else
+        std::size_t n = 0;
+        for (; not (w & 1); w >>= 1) ++n;
+        return n;
+#endif
+    }
+
+    void clear_tail() noexcept {
+        if (bits % word_bits != 0) words.back() &= (word_type(1) << bits % word_bits) - 1;
+    }
+
+    std::vector<word_type> words;
+    std::size_t bits = 0;
+};
+
+} // namespace base
+
+#endif // ndef BASE_PTR_INTERNER_HPP
@@ -1,13 +1,134 @@
 #ifndef BASE_PTR_IO_HPP
 #define BASE_PTR_IO_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <system_error>
 #include "ptr.hpp"
 
 namespace base {
+
+// Pointers are formatted as "0x" followed by a fixed number of lowercase hex
+// digits, independently of the platform and of any stream locale.
+constexpr std::size_t hex_ptr_width = 2 + 2 * sizeof(std::uintptr_t);
+
+// Mirrors C++17 `std::to_chars_result`.
+struct to_chars_result {
+    char* ptr;
+    std::errc ec;
+};
+
+namespace detail {
+    inline char const* hex_byte_table() noexcept {
+        static constexpr char table[] =
+            "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+            "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+            "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+            "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+            "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+            "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+            "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+            "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+        return table;
+    }
+
+    // Writes exactly `hex_ptr_width` characters, one table lookup per byte.
+    inline void write_hex_ptr(char* out, std::uintptr_t value) noexcept {
+        char const* const table = hex_byte_table();
+        out[0] = '0';
+        out[1] = 'x';
+        for (std::size_t i = sizeof value; i != 0; --i) {
+            std::memcpy(out + 2 * i, table + 2 * (value & 0xff), 2);
+            value >>= 8;
+        }
+    }
+
+    template <typename T>
+    inline std::uintptr_t address_of(ptr<T> p) noexcept {
+        return reinterpret_cast<std::uintptr_t>(p.get());
+    }
+} // namespace detail
+
+// Writes `p` into `[first, last)` without a terminating NUL. On success,
+// `ptr` points past the last character written; if the range is too short,
+// nothing is written and `ec` is `std::errc::value_too_large`.
+template <typename T>
+inline to_chars_result to_chars(char* first, char* last, ptr<T> p) noexcept {
+    if (static_cast<std::size_t>(last - first) < hex_ptr_width) {
+        return to_chars_result{last, std::errc::value_too_large};
+    }
+    detail::write_hex_ptr(first, detail::address_of(p));
+    return to_chars_result{first + hex_ptr_width, std::errc()};
+}
+
+// Formatted pointer in an inline, NUL-terminated buffer.
+class hex_ptr_buffer {
+public:
+    char const* data() const noexcept { return chars; }
+
+    char const* c_str() const noexcept { return chars; }
+
+    static constexpr std::size_t size() noexcept { return hex_ptr_width; }
+
+    std::string str() const { return std::string(chars, hex_ptr_width); }
+
+private:
+    template <typename T>
+    friend hex_ptr_buffer format_hex(ptr<T>) noexcept;
+
+    char chars[hex_ptr_width + 1];
+};
+
+template <typename T>
+inline hex_ptr_buffer format_hex(ptr<T> p) noexcept {
+    hex_ptr_buffer buffer;
+    detail::write_hex_ptr(buffer.chars, detail::address_of(p));
+    buffer.chars[hex_ptr_width] = '\0';
+    return buffer;
+}
+
+namespace detail {
+    inline bool put_fill(std::streambuf& buffer, char fill, std::streamsize n) {
+        for (; n > 0; --n) {
+            if (buffer.sputc(fill) == std::char_traits<char>::eof()) return false;
+        }
+        return true;
+    }
+
+    inline bool put_chars(std::streambuf& buffer, char const* chars, std::streamsize n) {
+        return buffer.sputn(chars, n) == n;
+    }
+} // namespace detail
+
+// Honours the stream's width, fill and adjustment like other formatted
+// output: padding goes before the pointer by default, after it with
+// `std::left`, and after the "0x" with `std::internal`. The width is reset.
 template <typename T>
 inline std::ostream& operator <<(std::ostream& out, ptr<T> p) {
-    return out << p.get();
+    std::ostream::sentry const ok(out);
+    if (not ok) return out;
+
+    auto const buffer = format_hex(p);
+    auto const size = static_cast<std::streamsize>(buffer.size());
+    auto const padding = out.width() > size ? out.width() - size : 0;
+    auto const adjust = out.flags() & std::ios_base::adjustfield;
+    auto const fill = out.fill();
+    auto& sink = *out.rdbuf();
+    bool written;
+    if (adjust == std::ios_base::left) {
+        written = detail::put_chars(sink, buffer.data(), size) and detail::put_fill(sink, fill, padding);
+    } else if (adjust == std::ios_base::internal) {
+        written = detail::put_chars(sink, buffer.data(), 2) and detail::put_fill(sink, fill, padding) and
+            detail::put_chars(sink, buffer.data() + 2, size - 2);
+    } else {
+        written = detail::put_fill(sink, fill, padding) and detail::put_chars(sink, buffer.data(), size);
+    }
+    out.width(0);
+    if (not written) out.setstate(std::ios_base::badbit);
+    return out;
 }
 } // namespace base
 
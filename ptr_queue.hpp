@@ -0,0 +1,224 @@
+#ifndef BASE_PTR_QUEUE_HPP
+#define BASE_PTR_QUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include "ptr.hpp"
+
+// Bounded lock-free FIFO queues of non-null `ptr<T>`. Both queues store bare
+// pointer words and report "empty" by returning `nullptr` from `try_pop`, so
+// `nullptr` itself cannot be pushed: `try_push(nullptr)` fails and a null
+// element ends a batch, as a full queue would. Capacities are rounded up to a
+// power of two.
+//
+// Indices written by different threads are kept on separate cache lines with
+// padding arrays rather than `alignas`: `new` in C++11 does not honour
+// over-alignment, and the queues are usually allocated on the heap.
+
+namespace base {
+
+namespace detail {
+    constexpr std::size_t cache_line = 64;
+
+    inline std::size_t queue_capacity(std::size_t capacity) noexcept {
+        std::size_t result = 2;
+        while (result < capacity) result *= 2;
+        return result;
+    }
+
+    // Length of the non-null prefix of the first `n` elements of `first`.
+    template <typename T>
+    std::size_t non_null_prefix(ptr<T> const* first, std::size_t n) noexcept {
+        return static_cast<std::size_t>(std::find(first, first + n, nullptr) - first);
+    }
+
+    template <typename T>
+    struct padded {
+        T value;
+        char padding[cache_line - sizeof(T) % cache_line];
+    };
+} // namespace detail
+
+// Single-producer, single-consumer queue. A slot is free if it holds
+// `nullptr`: the producer only checks the slot it writes next, the consumer
+// only the slot it reads next, and each index is private to its thread.
+template <typename T>
+class spsc_ptr_queue {
+public:
+    explicit spsc_ptr_queue(std::size_t capacity)
+        : mask(detail::queue_capacity(capacity) - 1), slots(new std::atomic<T*>[mask + 1]) {
+        for (std::size_t i = 0; i <= mask; ++i) slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    spsc_ptr_queue(spsc_ptr_queue const&) = delete;
+    spsc_ptr_queue& operator =(spsc_ptr_queue const&) = delete;
+
+    std::size_t capacity() const noexcept { return mask + 1; }
+
+    // Producer only. Returns false if the queue is full or `p` is null.
+    bool try_push(ptr<T> p) noexcept {
+        if (p == nullptr) return false;
+        auto& slot = slots[head.value & mask];
+        if (slot.load(std::memory_order_acquire) != nullptr) return false;
+        slot.store(p.get(), std::memory_order_release);
+        ++head.value;
+        return true;
+    }
+
+    // Producer only. Pushes a prefix of `[first, last)` and returns its
+    // length. The consumer frees slots in order, so if the last slot of a
+    // batch is free, all of them are.
+    std::size_t push(ptr<T> const* first, ptr<T> const* last) noexcept {
+        auto const n = detail::non_null_prefix(first,
+            std::min(static_cast<std::size_t>(last - first), capacity()));
+        if (n == 0) return 0;
+        if (slots[(head.value + n - 1) & mask].load(std::memory_order_acquire) != nullptr) {
+            std::size_t pushed = 0;
+            while (pushed != n and try_push(first[pushed])) ++pushed;
+            return pushed;
+        }
+        for (std::size_t i = 0; i != n; ++i) {
+            slots[(head.value + i) & mask].store(first[i].get(), std::memory_order_release);
+        }
+        head.value += n;
+        return n;
+    }
+
+    // Consumer only. Returns `nullptr` if the queue is empty.
+    ptr<T> try_pop() noexcept {
+        auto& slot = slots[tail.value & mask];
+        auto const p = slot.load(std::memory_order_acquire);
+        if (p == nullptr) return nullptr;
+        slot.store(nullptr, std::memory_order_release);
+        ++tail.value;
+        return raw_ptr(p);
+    }
+
+    // Consumer only. Pops up to `max` elements into `out`; returns how many.
+    std::size_t pop(ptr<T>* out, std::size_t max) noexcept {
+        std::size_t popped = 0;
+        for (; popped != max; ++popped) {
+            auto const p = try_pop();
+            if (p == nullptr) break;
+            out[popped] = p;
+        }
+        return popped;
+    }
+
+private:
+    char leading_padding[detail::cache_line];
+    detail::padded<std::size_t> head = { };
+    detail::padded<std::size_t> tail = { };
+    std::size_t const mask;
+    std::unique_ptr<std::atomic<T*>[]> slots;
+};
+
+// Multi-producer, multi-consumer queue (Vyukov's bounded queue). Every cell
+// carries a sequence number telling which lap of the ring may use it next:
+// producers claim positions whose cell is ready for writing, consumers
+// positions whose cell has been written, each with one CAS on a shared index.
+template <typename T>
+class mpmc_ptr_queue {
+public:
+    explicit mpmc_ptr_queue(std::size_t capacity)
+        : mask(detail::queue_capacity(capacity) - 1), cells(new cell[mask + 1]) {
+        for (std::size_t i = 0; i <= mask; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+        enqueue_pos.value.store(0, std::memory_order_relaxed);
+        dequeue_pos.value.store(0, std::memory_order_relaxed);
+    }
+
+    mpmc_ptr_queue(mpmc_ptr_queue const&) = delete;
+    mpmc_ptr_queue& operator =(mpmc_ptr_queue const&) = delete;
+
+    std::size_t capacity() const noexcept { return mask + 1; }
+
+    // Returns false if the queue is full or `p` is null.
+    bool try_push(ptr<T> p) noexcept { return push(&p, &p + 1) == 1; }
+
+    // Pushes a prefix of `[first, last)` and returns its length. The
+    // positions for the whole prefix are claimed with a single CAS.
+    std::size_t push(ptr<T> const* first, ptr<T> const* last) noexcept {
+        auto const wanted = detail::non_null_prefix(first,
+            std::min(static_cast<std::size_t>(last - first), capacity()));
+        if (wanted == 0) return 0;
+        auto pos = enqueue_pos.value.load(std::memory_order_relaxed);
+        for (;;) {
+            auto const n = ready(pos, wanted, 0);
+            if (n == 0) {
+                // Either full, or another producer claimed `pos` already.
+                auto const current = enqueue_pos.value.load(std::memory_order_relaxed);
+                if (current == pos) return 0;
+                pos = current;
+                continue;
+            }
+            if (enqueue_pos.value.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+                for (std::size_t i = 0; i != n; ++i) {
+                    auto& c = cells[(pos + i) & mask];
+                    c.data = first[i].get();
+                    c.sequence.store(pos + i + 1, std::memory_order_release);
+                }
+                return n;
+            }
+        }
+    }
+
+    // Returns `nullptr` if the queue is empty.
+    ptr<T> try_pop() noexcept {
+        ptr<T> p = nullptr;
+        pop(&p, 1);
+        return p;
+    }
+
+    // Pops up to `max` elements into `out`, claiming their positions with a
+    // single CAS; returns how many.
+    std::size_t pop(ptr<T>* out, std::size_t max) noexcept {
+        auto const wanted = std::min(max, capacity());
+        auto pos = dequeue_pos.value.load(std::memory_order_relaxed);
+        for (;;) {
+            auto const n = ready(pos, wanted, 1);
+            if (n == 0) {
+                auto const current = dequeue_pos.value.load(std::memory_order_relaxed);
+                if (current == pos) return 0;
+                pos = current;
+                continue;
+            }
+            if (dequeue_pos.value.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+                for (std::size_t i = 0; i != n; ++i) {
+                    auto& c = cells[(pos + i) & mask];
+                    out[i] = raw_ptr(c.data);
+                    c.sequence.store(pos + i + mask + 1, std::memory_order_release);
+                }
+                return n;
+            }
+        }
+    }
+
+private:
+    struct cell {
+        std::atomic<std::size_t> sequence;
+        T* data;
+    };
+
+    // Length of the run of cells from `pos` (at most `n`) whose sequence
+    // number is their position plus `offset`: 0 for free cells, 1 for full
+    // ones.
+    std::size_t ready(std::size_t pos, std::size_t n, std::size_t offset) const noexcept {
+        std::size_t i = 0;
+        while (i != n and cells[(pos + i) & mask].sequence.load(std::memory_order_acquire) == pos + i + offset) {
+            ++i;
+        }
+        return i;
+    }
+
+    char leading_padding[detail::cache_line];
+    detail::padded<std::atomic<std::size_t>> enqueue_pos;
+    detail::padded<std::atomic<std::size_t>> dequeue_pos;
+    std::size_t const mask;
+    std::unique_ptr<cell[]> cells;
+};
+
+} // namespace base
+
+#endif // ndef BASE_PTR_QUEUE_HPP
@@ -0,0 +1,265 @@
+#ifndef BASE_PTR_SYMBOL_HPP
+#define BASE_PTR_SYMBOL_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include "ptr.hpp"
+#include "ptr_io.hpp"
+
+namespace base {
+
+namespace detail {
+    // Owned, NUL-terminated copy of a (demangled, if possible) symbol name.
+    inline char const* demangled_copy(char const* name) noexcept {
+        int status = 0;
+        if (char* const demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status)) {
+            return demangled;
+        }
+        auto const length = std::strlen(name) + 1;
+        auto const copy = static_cast<char*>(std::malloc(length));
+        if (copy != nullptr) std::memcpy(copy, name, length);
+        return copy;
+    }
+
+    // Finds the symbol containing `address` in the loaded objects' dynamic
+    // symbol tables. Executables only export their symbols when linked with
+    // `-rdynamic`.
+    inline char const* lookup_symbol(void const* address) noexcept {
+        Dl_info info;
+        if (::dladdr(address, &info) == 0 or info.dli_sname == nullptr) return nullptr;
+        return demangled_copy(info.dli_sname);
+    }
+
+    // Lock-free cache from addresses to names. Entries are never removed, so
+    // the names handed out stay valid for the whole process. Misses can be
+    // cached too; callers only do so for keys drawn from a bounded set, such
+    // as vptrs and function addresses, and not for heap or stack addresses,
+    // which would fill the table. Once a probe sequence is exhausted,
+    // lookups for further addresses bypass the cache.
+    class symbol_cache {
+    public:
+        static constexpr std::size_t capacity = 4096;
+        static constexpr std::size_t max_probes = 16;
+
+        // Returns `true` and sets `name` on a hit.
+        bool find(std::uintptr_t address, char const*& name) const noexcept {
+            for (std::size_t i = 0, slot = home(address); i != max_probes; ++i, slot = next(slot)) {
+                auto const key = entries[slot].key.load(std::memory_order_acquire);
+                if (key == 0) return false;
+                if (key == address) {
+                    auto const value = entries[slot].name.load(std::memory_order_acquire);
+                    // A concurrent insertion claimed the key but has not yet
+                    // published the name.
+                    if (value == nullptr) return false;
+                    name = value == unknown() ? nullptr : value;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Takes ownership of `name` and returns the cached name for
+        // `address`, which may be one inserted concurrently by another
+        // thread; a null `name` caches a miss. Returns `false` if there is no
+        // free slot, leaving `name` to the caller.
+        bool insert(std::uintptr_t address, char const*& name) noexcept {
+            for (std::size_t i = 0, slot = home(address); i != max_probes; ++i, slot = next(slot)) {
+                auto& entry = entries[slot];
+                std::uintptr_t key = 0;
+                if (entry.key.compare_exchange_strong(key, address, std::memory_order_acq_rel) or
+                        key == address) {
+                    char const* expected = nullptr;
+                    if (entry.name.compare_exchange_strong(expected, name == nullptr ? unknown() : name,
+                            std::memory_order_acq_rel)) {
+                        return true;
+                    }
+                    std::free(const_cast<char*>(name));
+                    name = expected == unknown() ? nullptr : expected;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct entry {
+            std::atomic<std::uintptr_t> key;
+            std::atomic<char const*> name;
+        };
+
+        static char const* unknown() noexcept {
+            static char const marker = '\0';
+            return &marker;
+        }
+
+        static std::size_t home(std::uintptr_t address) noexcept {
+            return static_cast<std::size_t>((address >> 3) * 0x9e3779b97f4a7c15ull >> 32) & (capacity - 1);
+        }
+
+        static std::size_t next(std::size_t slot) noexcept {
+            return (slot + 1) & (capacity - 1);
+        }
+
+        entry entries[capacity];
+    };
+
+    // Zero-initialised, so there is no initialisation to synchronise.
+    inline symbol_cache& global_symbol_cache() noexcept {
+        static symbol_cache cache;
+        return cache;
+    }
+
+    // Demangled dynamic type names of polymorphic objects, keyed by vptr.
+    inline symbol_cache& global_type_name_cache() noexcept {
+        static symbol_cache cache;
+        return cache;
+    }
+
+    // Name of the symbol containing `address`, or `nullptr`; misses are
+    // cached if `cache_misses` is set. If the name could not be cached,
+    // `owned` is set and the caller must free it.
+    inline char const* find_symbol(void const* address, bool cache_misses, bool& owned) noexcept {
+        auto& cache = global_symbol_cache();
+        auto const key = reinterpret_cast<std::uintptr_t>(address);
+        char const* name;
+        owned = false;
+        if (key == 0) return nullptr;
+        if (cache.find(key, name)) return name;
+        name = lookup_symbol(address);
+        if (name == nullptr and not cache_misses) return nullptr;
+        owned = not cache.insert(key, name) and name != nullptr;
+        return name;
+    }
+
+    // Demangled name of `type`, the dynamic type of objects with the vptr
+    // `vptr`, with the same ownership rule as `find_symbol`.
+    inline char const* find_type_name(void const* vptr, std::type_info const& type, bool& owned) noexcept {
+        auto& cache = global_type_name_cache();
+        auto const key = reinterpret_cast<std::uintptr_t>(vptr);
+        char const* name;
+        owned = false;
+        if (cache.find(key, name) and name != nullptr) return name;
+        int status = 0;
+        name = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+        if (name == nullptr) return type.name();
+        owned = not cache.insert(key, name);
+        return name;
+    }
+
+    template <typename T>
+    inline void const* object_address(ptr<T> p, std::true_type /* is_polymorphic */) noexcept {
+        // Under the Itanium C++ ABI, the complete object starts with its vptr.
+        auto const object = dynamic_cast<void const volatile*>(p.get());
+        return *reinterpret_cast<void const* const*>(const_cast<void const*>(object));
+    }
+
+    template <typename T>
+    inline void const* object_address(ptr<T> p, std::false_type /* is_polymorphic */) noexcept {
+        return const_cast<void const*>(static_cast<void const volatile*>(p.get()));
+    }
+
+    template <typename T>
+    inline void const* symbol_address(ptr<T> p, std::true_type /* is_function */) noexcept {
+        return reinterpret_cast<void const*>(p.get());
+    }
+
+    template <typename T>
+    inline void const* symbol_address(ptr<T> p, std::false_type /* is_function */) noexcept {
+        return object_address(p, std::is_polymorphic<T>());
+    }
+
+    template <typename T>
+    constexpr bool caches_misses() noexcept {
+        return std::is_function<T>::value or std::is_polymorphic<T>::value;
+    }
+} // namespace detail
+
+// Name of the symbol containing `address`, or `nullptr` if there is none.
+// The first lookup of an address searches the symbol tables; subsequent ones
+// are a hash lookup. Returned names remain valid until the process exits, so
+// they must be cached: once the cache has no room for a name, this returns
+// `nullptr` as well (`with_symbol` still prints it).
+inline char const* symbol_name(void const* address) noexcept {
+    bool owned;
+    char const* const name = detail::find_symbol(address, false, owned);
+    if (not owned) return name;
+    std::free(const_cast<char*>(name));
+    return nullptr;
+}
+
+// Symbol for the target of `p`: the function for function pointers, the
+// vtable of the dynamic type for polymorphic objects, and the object itself
+// (e.g. a global variable) otherwise. `nullptr` if `p` is null or the
+// symbol is not found. For functions and polymorphic objects, the key set is
+// bounded by the program's code and types, so misses are cached as well.
+template <typename T>
+inline char const* symbol_name(ptr<T> p) noexcept {
+    if (p == nullptr) return nullptr;
+    bool owned;
+    char const* const name = detail::find_symbol(detail::symbol_address(p, std::is_function<T>()),
+        detail::caches_misses<T>(), owned);
+    if (not owned) return name;
+    std::free(const_cast<char*>(name));
+    return nullptr;
+}
+
+template <typename T>
+struct symbolized {
+    ptr<T> value;
+};
+
+// Opt-in printer: `out << with_symbol(p)` writes the address of `p` followed
+// by its symbol name in angle brackets, if one is known. For polymorphic
+// objects whose vtable is not exported, the dynamic type's name is used.
+template <typename T>
+inline symbolized<T> with_symbol(ptr<T> p) noexcept {
+    return symbolized<T>{p};
+}
+
+namespace detail {
+    // Frees a name that could not be cached, even if the stream throws.
+    struct free_on_exit {
+        char const* name;
+        ~free_on_exit() { std::free(const_cast<char*>(name)); }
+    };
+
+    template <typename T>
+    inline void print_type_fallback(std::ostream& out, ptr<T> p, std::true_type /* is_polymorphic */) {
+        bool owned;
+        char const* const name = find_type_name(object_address(p, std::true_type()), typeid(*p), owned);
+        free_on_exit const release{owned ? name : nullptr};
+        out << " <" << name << '>';
+    }
+
+    template <typename T>
+    inline void print_type_fallback(std::ostream&, ptr<T>, std::false_type /* is_polymorphic */) { }
+} // namespace detail
+
+template <typename T>
+inline std::ostream& operator <<(std::ostream& out, symbolized<T> s) {
+    out << s.value;
+    if (s.value == nullptr) return out;
+    bool owned;
+    char const* const name = detail::find_symbol(detail::symbol_address(s.value, std::is_function<T>()),
+        detail::caches_misses<T>(), owned);
+    if (name != nullptr) {
+        detail::free_on_exit const release{owned ? name : nullptr};
+        out << " <" << name << '>';
+    } else {
+        detail::print_type_fallback(out, s.value,
+            std::integral_constant<bool, std::is_polymorphic<T>::value>());
+    }
+    return out;
+}
+
+} // namespace base
+
+#endif // ndef BASE_PTR_SYMBOL_HPP
@@ -0,0 +1,304 @@
+#ifndef BASE_PTR_TRACE_HPP
+#define BASE_PTR_TRACE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Sampled dereference tracing. When `BASE_PTR_TRACE` is defined, `ptr.hpp`
+// calls `base::trace::record` from `operator *` and `operator ->`; without
+// it, nothing in this header is used and `ptr` is unchanged.
+//
+// Every thread counts its dereferences and records every Nth address into a
+// thread-local ring buffer, so the fast path is a decrement of a thread-local
+// counter. `aggregate` and `dump` read all buffers, including those of
+// threads that have exited. An exited thread's buffer goes back to a free
+// list and is taken over by the next thread that starts recording, so there
+// are only as many buffers as threads ever ran at the same time; dereferences
+// after a thread's thread-local objects are destroyed are not recorded.
+
+#ifndef BASE_PTR_TRACE_BUFFER_SIZE
+#   define BASE_PTR_TRACE_BUFFER_SIZE 4096
+#endif
+
+#ifndef BASE_PTR_TRACE_SAMPLE_PERIOD
+#   define BASE_PTR_TRACE_SAMPLE_PERIOD 64
+#endif
+
+namespace base {
+namespace trace {
+
+constexpr std::size_t cache_line_size = 64;
+
+// Fixed-size ring of sampled addresses. Only the owning thread writes; older
+// events are overwritten once the buffer is full. Other threads clear the
+// buffer by advancing an epoch: events from earlier epochs are ignored, and
+// the owner resets the buffer when it next pushes in a new one.
+class ring_buffer {
+public:
+    static constexpr std::size_t capacity = BASE_PTR_TRACE_BUFFER_SIZE;
+
+    static_assert((capacity & (capacity - 1)) == 0, "Buffer size must be a power of two");
+
+    ring_buffer() noexcept : head(0), epoch(0) {
+        for (auto& slot : slots) slot.store(0, std::memory_order_relaxed);
+    }
+
+    // Owner only.
+    void push(std::uintptr_t address, std::uint64_t current_epoch) noexcept {
+        auto h = head.load(std::memory_order_relaxed);
+        if (epoch.load(std::memory_order_relaxed) != current_epoch) {
+            h = 0;
+            head.store(0, std::memory_order_relaxed);
+            epoch.store(current_epoch, std::memory_order_release);
+        }
+        slots[h & (capacity - 1)].store(address, std::memory_order_relaxed);
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    // Copies the events retained in `current_epoch`. Events written
+    // concurrently may or may not be included.
+    void snapshot(std::vector<std::uintptr_t>& out, std::uint64_t current_epoch) const {
+        if (epoch.load(std::memory_order_acquire) != current_epoch) return;
+        auto const h = head.load(std::memory_order_acquire);
+        auto const n = std::min<std::uint64_t>(h, std::uint64_t(capacity));
+        for (auto i = h - n; i != h; ++i) {
+            out.push_back(slots[i & (capacity - 1)].load(std::memory_order_relaxed));
+        }
+    }
+
+private:
+    std::atomic<std::uint64_t> head;
+    std::atomic<std::uint64_t> epoch;
+    std::atomic<std::uintptr_t> slots[capacity];
+};
+
+namespace detail {
+    struct site {
+        std::uintptr_t end;
+        std::string name;
+    };
+
+    struct buffer_node {
+        ring_buffer buffer;
+        // All buffers ever created, and those of exited threads.
+        buffer_node* next;
+        buffer_node* next_free;
+    };
+
+    struct registry {
+        std::mutex mutex;
+        buffer_node* buffers = nullptr;
+        buffer_node* free = nullptr;
+        std::map<std::uintptr_t, site> sites;
+        std::atomic<unsigned> period{BASE_PTR_TRACE_SAMPLE_PERIOD};
+        std::atomic<std::uint64_t> epoch{0};
+    };
+
+    inline registry& global() noexcept {
+        // Never destroyed, so that dereferences during static destruction
+        // can still be recorded, and not allocated, so that it cannot fail.
+        static std::aligned_storage<sizeof(registry), alignof(registry)>::type storage;
+        static registry* instance = new (&storage) registry;
+        return *instance;
+    }
+
+    struct thread_state {
+        buffer_node* node;
+        bool exited;
+    };
+
+    // Trivially destructible, so that it can be read at any time.
+    inline thread_state& this_thread() noexcept {
+        static thread_local thread_state state = { nullptr, false };
+        return state;
+    }
+
+    // Hands the buffer of an exiting thread on to the free list.
+    struct buffer_release {
+        ~buffer_release() {
+            auto& state = this_thread();
+            state.exited = true;
+            if (state.node == nullptr) return;
+            auto& r = global();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            state.node->next_free = r.free;
+            r.free = state.node;
+            state.node = nullptr;
+        }
+    };
+
+    // Takes a buffer from the free list, or allocates one. Returns `nullptr`
+    // if allocation fails, rather than throwing from `record`.
+    inline buffer_node* acquire_buffer() noexcept {
+        static thread_local buffer_release release;
+        (void) release;
+        auto& r = global();
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            if (auto const node = r.free) {
+                r.free = node->next_free;
+                return node;
+            }
+        }
+        auto const node = new (std::nothrow) buffer_node;
+        if (node == nullptr) return nullptr;
+        node->next_free = nullptr;
+        std::lock_guard<std::mutex> lock(r.mutex);
+        node->next = r.buffers;
+        r.buffers = node;
+        return node;
+    }
+
+    inline ring_buffer* thread_buffer() noexcept {
+        auto& state = this_thread();
+        if (state.node == nullptr and not state.exited) state.node = acquire_buffer();
+        return state.node != nullptr ? &state.node->buffer : nullptr;
+    }
+
+    // Dereferences left until the calling thread records its next sample.
+    inline unsigned& countdown() noexcept {
+        static thread_local unsigned remaining = 0;
+        return remaining;
+    }
+
+    inline void record_sample(std::uintptr_t address) noexcept {
+        auto& r = global();
+        countdown() = r.period.load(std::memory_order_relaxed);
+        if (auto const buffer = thread_buffer()) buffer->push(address, r.epoch.load(std::memory_order_acquire));
+    }
+} // namespace detail
+
+inline void record(void const volatile* address) noexcept {
+    auto& remaining = detail::countdown();
+    if (remaining > 1) {
+        --remaining;
+        return;
+    }
+    detail::record_sample(reinterpret_cast<std::uintptr_t>(address));
+}
+
+// Records one in every `period` dereferences per thread (1 records all). The
+// calling thread samples its next dereference; other threads switch to the
+// new period after their next sample.
+inline void set_sample_period(unsigned period) noexcept {
+    detail::global().period.store(period == 0 ? 1 : period, std::memory_order_relaxed);
+    detail::countdown() = 0;
+}
+
+// Names the allocation `[begin, begin + size)` so that `aggregate` can
+// attribute sampled addresses to it. Typically called right after allocating.
+inline void register_site(void const volatile* begin, std::size_t size, std::string name) {
+    auto& r = detail::global();
+    auto const first = reinterpret_cast<std::uintptr_t>(begin);
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.sites[first] = detail::site{first + size, std::move(name)};
+}
+
+inline void unregister_site(void const volatile* begin) {
+    auto& r = detail::global();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.sites.erase(reinterpret_cast<std::uintptr_t>(begin));
+}
+
+// Discards all recorded events (but keeps registered sites). Each thread
+// resets its own buffer when it next records.
+inline void clear() noexcept {
+    detail::global().epoch.fetch_add(1, std::memory_order_release);
+}
+
+using histogram = std::vector<std::pair<std::uintptr_t, std::size_t>>;
+
+struct profile {
+    std::size_t samples;
+    histogram by_address;
+    histogram by_cache_line;
+    // Sampled addresses outside every registered site are counted under
+    // "<unknown>".
+    std::vector<std::pair<std::string, std::size_t>> by_site;
+};
+
+namespace detail {
+    template <typename Key>
+    std::vector<std::pair<Key, std::size_t>> sorted_counts(std::map<Key, std::size_t> const& counts) {
+        std::vector<std::pair<Key, std::size_t>> result(counts.begin(), counts.end());
+        std::stable_sort(result.begin(), result.end(),
+            [](std::pair<Key, std::size_t> const& a, std::pair<Key, std::size_t> const& b) {
+                return a.second > b.second;
+            });
+        return result;
+    }
+} // namespace detail
+
+// Aggregates the events of all threads. Histograms are sorted by decreasing
+// count.
+inline profile aggregate() {
+    auto& r = detail::global();
+    std::vector<std::uintptr_t> events;
+    std::map<std::uintptr_t, std::size_t> addresses;
+    std::map<std::uintptr_t, std::size_t> lines;
+    std::map<std::string, std::size_t> sites;
+
+    auto const epoch = r.epoch.load(std::memory_order_acquire);
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto node = r.buffers; node != nullptr; node = node->next) node->buffer.snapshot(events, epoch);
+
+    for (auto address : events) {
+        ++addresses[address];
+        ++lines[address & ~std::uintptr_t(cache_line_size - 1)];
+
+        auto site = r.sites.upper_bound(address);
+        if (site != r.sites.begin() and address < (--site)->second.end) {
+            ++sites[site->second.name];
+        } else {
+            ++sites["<unknown>"];
+        }
+    }
+
+    return profile{
+        events.size(),
+        detail::sorted_counts(addresses),
+        detail::sorted_counts(lines),
+        detail::sorted_counts(sites)
+    };
+}
+
+// Writes the `top` hottest entries of each histogram in a plain text report.
+inline void dump(std::ostream& out, std::size_t top = 20) {
+    auto const p = aggregate();
+    auto const flags = out.flags();
+
+    out << "samples: " << p.samples << '\n';
+
+    auto const print = [&](char const* title, histogram const& h) {
+        out << title << ":\n";
+        for (std::size_t i = 0; i != std::min(top, h.size()); ++i) {
+            out << "  0x" << std::hex << std::setw(16) << std::setfill('0') << h[i].first
+                << std::dec << std::setfill(' ') << ' ' << h[i].second << '\n';
+        }
+    };
+    print("by address", p.by_address);
+    print("by cache line", p.by_cache_line);
+
+    out << "by site:\n";
+    for (std::size_t i = 0; i != std::min(top, p.by_site.size()); ++i) {
+        out << "  " << p.by_site[i].first << ' ' << p.by_site[i].second << '\n';
+    }
+
+    out.flags(flags);
+}
+
+} // namespace trace
+} // namespace base
+
+#endif // ndef BASE_PTR_TRACE_HPP
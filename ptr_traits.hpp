@@ -0,0 +1,34 @@
+#ifndef BASE_PTR_TRAITS_HPP
+#define BASE_PTR_TRAITS_HPP
+
+// Standard library integration of `base::ptr`. Kept apart from `ptr.hpp` so
+// that the core header does not pull in <memory> and <functional>.
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include "ptr.hpp"
+
+namespace std {
+    template <typename T>
+    struct pointer_traits<base::ptr<T>> {
+        using pointer = T*;
+        using element_type = T;
+        using difference_type = ptrdiff_t;
+
+        template <typename U>
+        using rebind = base::ptr<U>;
+    };
+
+    template <typename T>
+    struct hash<base::ptr<T>> {
+        using result_type = size_t;
+        using argument_type = base::ptr<T>;
+
+        result_type operator ()(argument_type const& p) const noexcept {
+            return std::hash<typename base::ptr<T>::pointer>()(p.get());
+        }
+    };
+} // namespace std
+
+#endif // ndef BASE_PTR_TRAITS_HPP
@@ -0,0 +1,247 @@
+#ifndef BASE_RADIX_SORT_HPP
+#define BASE_RADIX_SORT_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ptr.hpp"
+
+namespace base {
+
+namespace detail {
+    constexpr std::size_t radix_digits = sizeof(std::uintptr_t);
+    constexpr std::size_t radix_buckets = 256;
+    // Below this size, sorting by comparison is faster than setting up the
+    // histograms.
+    constexpr std::size_t radix_threshold = 256;
+
+    using radix_histogram = std::size_t[radix_digits][radix_buckets];
+
+    template <typename T>
+    inline std::uintptr_t radix_key(ptr<T> p) noexcept {
+        return reinterpret_cast<std::uintptr_t>(p.get());
+    }
+
+    template <typename T>
+    inline std::size_t radix_digit(ptr<T> p, std::size_t digit) noexcept {
+        return radix_key(p) >> (8 * digit) & (radix_buckets - 1);
+    }
+
+    template <typename T>
+    void radix_count(ptr<T> const* first, ptr<T> const* last, radix_histogram& counts) noexcept {
+        std::fill(&counts[0][0], &counts[0][0] + radix_digits * radix_buckets, 0);
+        for (; first != last; ++first) {
+            auto key = radix_key(*first);
+            for (std::size_t digit = 0; digit != radix_digits; ++digit, key >>= 8) {
+                ++counts[digit][key & (radix_buckets - 1)];
+            }
+        }
+    }
+
+    // Pointers share their high bytes (limited address space) and low bytes
+    // (alignment); digits that are the same for all keys need no pass.
+    inline std::vector<std::size_t> radix_passes(radix_histogram const& counts, std::size_t n) {
+        std::vector<std::size_t> passes;
+        for (std::size_t digit = 0; digit != radix_digits; ++digit) {
+            auto const bucket = counts[digit];
+            if (std::find(bucket, bucket + radix_buckets, n) == bucket + radix_buckets) {
+                passes.push_back(digit);
+            }
+        }
+        return passes;
+    }
+
+    template <typename T>
+    void radix_scatter(ptr<T> const* first, ptr<T> const* last, ptr<T>* out,
+            std::size_t digit, std::size_t (&offsets)[radix_buckets]) noexcept {
+        for (; first != last; ++first) {
+            out[offsets[radix_digit(*first, digit)]++] = *first;
+        }
+    }
+
+    // Whether all `n` keys share one value of `digit`, according to the
+    // histograms of `threads` chunks.
+    inline bool radix_constant(radix_histogram const* counts, unsigned threads, std::size_t digit,
+            std::size_t n) noexcept {
+        for (std::size_t b = 0; b != radix_buckets; ++b) {
+            std::size_t sum = 0;
+            for (unsigned t = 0; t != threads; ++t) sum += counts[t][digit][b];
+            if (sum == n) return true;
+        }
+        return false;
+    }
+
+    // Reusable barrier for the threads of one `radix_parallel` call.
+    class radix_barrier {
+    public:
+        explicit radix_barrier(unsigned threads) noexcept : threads(threads), waiting(0), phase(0) { }
+
+        void wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto const current = phase;
+            if (++waiting == threads) {
+                waiting = 0;
+                ++phase;
+                lock.unlock();
+                changed.notify_all();
+                return;
+            }
+            changed.wait(lock, [&] { return phase != current; });
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable changed;
+        unsigned const threads;
+        unsigned waiting;
+        std::size_t phase;
+    };
+
+    // Runs `task(t)` for every t in [0, threads), on as many threads. The
+    // workers only start once all of them exist: if creating one throws, the
+    // others are told to quit and joined, since tasks that wait for each
+    // other could not finish and joinable threads would call
+    // `std::terminate` when destroyed.
+    template <typename F>
+    void radix_parallel(unsigned threads, F const& task) {
+        enum class gate { closed, open, cancelled };
+        std::mutex mutex;
+        std::condition_variable changed;
+        auto state = gate::closed;
+        auto const set = [&](gate g) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                state = g;
+            }
+            changed.notify_all();
+        };
+        auto const run = [&](unsigned t) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return state != gate::closed; });
+                if (state == gate::cancelled) return;
+            }
+            task(t);
+        };
+
+        std::vector<std::thread> workers;
+        try {
+            workers.reserve(threads - 1);
+            for (unsigned t = 1; t != threads; ++t) workers.emplace_back(run, t);
+        } catch (...) {
+            set(gate::cancelled);
+            for (auto& worker : workers) worker.join();
+            throw;
+        }
+        set(gate::open);
+        task(0);
+        for (auto& worker : workers) worker.join();
+    }
+} // namespace detail
+
+// Sorts `[first, last)` into the order defined by `operator <` on `ptr`, by
+// least significant digit radix sort on the address bytes. Byte positions
+// that are equal in all pointers are skipped. Every counting pass is stable,
+// as LSD radix sort requires; small ranges go to `std::sort`, but equal
+// pointers are indistinguishable either way. Uses a scratch buffer of the
+// same size.
+template <typename T>
+void radix_sort(ptr<T>* first, ptr<T>* last) {
+    auto const n = static_cast<std::size_t>(last - first);
+    if (n < detail::radix_threshold) {
+        std::sort(first, last);
+        return;
+    }
+
+    detail::radix_histogram counts;
+    detail::radix_count<T>(first, last, counts);
+
+    std::unique_ptr<ptr<T>[]> scratch(new ptr<T>[n]);
+    ptr<T>* from = first;
+    ptr<T>* to = scratch.get();
+    for (auto digit : detail::radix_passes(counts, n)) {
+        std::size_t offsets[detail::radix_buckets];
+        std::size_t sum = 0;
+        for (std::size_t b = 0; b != detail::radix_buckets; ++b) {
+            offsets[b] = sum;
+            sum += counts[digit][b];
+        }
+        detail::radix_scatter<T>(from, from + n, to, digit, offsets);
+        std::swap(from, to);
+    }
+    if (from != first) std::copy(from, from + n, first);
+}
+
+// Parallel variant of `radix_sort`, using `threads` threads for the whole
+// sort. Each pass histograms and scatters one contiguous chunk per thread,
+// with barriers in between; per-thread offsets are arranged so that the
+// result is the same as with one thread.
+template <typename T>
+void radix_sort(ptr<T>* first, ptr<T>* last, unsigned threads) {
+    auto const n = static_cast<std::size_t>(last - first);
+    if (threads == 0) threads = 1;
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, n / detail::radix_threshold));
+    if (threads <= 1) {
+        radix_sort(first, last);
+        return;
+    }
+
+    auto const chunk = (n + threads - 1) / threads;
+    auto const chunk_begin = [=](unsigned t) { return std::min(n, t * chunk); };
+
+    std::unique_ptr<detail::radix_histogram[]> counts(new detail::radix_histogram[threads]);
+    std::unique_ptr<ptr<T>[]> scratch(new ptr<T>[n]);
+    detail::radix_barrier barrier(threads);
+    ptr<T>* sorted = first;
+
+    detail::radix_parallel(threads, [&](unsigned t) {
+        ptr<T>* from = first;
+        ptr<T>* to = scratch.get();
+        auto const begin = chunk_begin(t);
+        auto const end = chunk_begin(t + 1);
+
+        // The first count also tells which digits are constant. Later
+        // passes recount their digit, since elements move between chunks.
+        detail::radix_count<T>(from + begin, from + end, counts[t]);
+        barrier.wait();
+        bool constant[detail::radix_digits];
+        for (std::size_t digit = 0; digit != detail::radix_digits; ++digit) {
+            constant[digit] = detail::radix_constant(counts.get(), threads, digit, n);
+        }
+
+        bool first_pass = true;
+        for (std::size_t digit = 0; digit != detail::radix_digits; ++digit) {
+            if (constant[digit]) continue;
+            if (not first_pass) {
+                auto& bucket = counts[t][digit];
+                std::fill(bucket, bucket + detail::radix_buckets, 0);
+                for (auto p = from + begin; p != from + end; ++p) ++bucket[detail::radix_digit(*p, digit)];
+                barrier.wait();
+            }
+            first_pass = false;
+
+            std::size_t offsets[detail::radix_buckets];
+            std::size_t sum = 0;
+            for (std::size_t b = 0; b != detail::radix_buckets; ++b) {
+                for (unsigned u = 0; u != threads; ++u) {
+                    if (u == t) offsets[b] = sum;
+                    sum += counts[u][digit][b];
+                }
+            }
+            detail::radix_scatter<T>(from + begin, from + end, to, digit, offsets);
+            barrier.wait();
+            std::swap(from, to);
+        }
+        if (t == 0) sorted = from;
+    });
+    if (sorted != first) std::copy(sorted, sorted + n, first);
+}
+
+} // namespace base
+
+#endif // ndef BASE_RADIX_SORT_HPP
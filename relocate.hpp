@@ -0,0 +1,181 @@
+#ifndef BASE_RELOCATE_HPP
+#define BASE_RELOCATE_HPP
+
+#include <cstddef>
+#include <vector>
+#include "ptr.hpp"
+#include "ptr_fields.hpp"
+#include "ptr_interner.hpp"
+
+// Relocation of graphs of `ptr`-linked `T` nodes into a fresh contiguous
+// arena. The `ptr<T>` fields of a node are enumerated by a field visitor with
+// a member `visit(T&, f)`, by default `ptr_fields<T>` (see ptr_fields.hpp).
+// The original nodes are left untouched; the caller frees them once nothing
+// refers to them any more.
+
+namespace base {
+
+namespace detail {
+    // Copies the nodes of `order` into a new arena, in that order, and
+    // redirects their fields and the roots to the copies. The interner
+    // doubles as forwarding table: a node's ID is its index in the arena.
+    template <typename T, typename Fields>
+    std::vector<T> relocate(ptr_interner<T> const& order, ptr<T>* roots_first, ptr<T>* roots_last,
+            Fields const& fields) {
+        std::vector<T> arena;
+        arena.reserve(order.size());
+        for (auto p : order) arena.push_back(*p);
+
+        auto const forward = [&](ptr<T>& field) {
+            if (field != nullptr) field = raw_ptr(&arena[order.find(field)]);
+        };
+        for (auto& node : arena) fields.visit(node, forward);
+        for (; roots_first != roots_last; ++roots_first) forward(*roots_first);
+        return arena;
+    }
+
+    // Non-null fields of `node`, in field order.
+    template <typename T, typename Fields>
+    void children(ptr<T> node, Fields const& fields, std::vector<ptr<T>>& out) {
+        fields.visit(*node, [&out](ptr<T>& field) {
+            if (field != nullptr) out.push_back(field);
+        });
+    }
+
+    // Interns the nodes reachable from the roots in breadth-first order and
+    // returns the number of levels. Interning assigns IDs in order of
+    // discovery, so walking the IDs is the breadth-first queue.
+    template <typename T, typename Fields>
+    std::size_t breadth_first_order(ptr<T> const* roots_first, ptr<T> const* roots_last,
+            Fields const& fields, ptr_interner<T>& order) {
+        using id_type = typename ptr_interner<T>::id_type;
+        for (; roots_first != roots_last; ++roots_first) {
+            if (*roots_first != nullptr) order.intern(*roots_first);
+        }
+        std::size_t levels = 0;
+        for (std::size_t begin = 0, end = order.size(); begin != end; begin = end, end = order.size()) {
+            for (auto id = begin; id != end; ++id) {
+                fields.visit(*order[static_cast<id_type>(id)], [&order](ptr<T>& field) {
+                    if (field != nullptr) order.intern(field);
+                });
+            }
+            ++levels;
+        }
+        return levels;
+    }
+
+    template <typename T, typename Fields>
+    void depth_first_order(ptr<T> root, Fields const& fields, ptr_interner<T>& order) {
+        if (root == nullptr) return;
+        std::vector<ptr<T>> stack = { root };
+        std::vector<ptr<T>> next;
+        while (not stack.empty()) {
+            auto const node = stack.back();
+            stack.pop_back();
+            if (order.contains(node)) continue;
+            order.intern(node);
+            next.clear();
+            children(node, fields, next);
+            stack.insert(stack.end(), next.rbegin(), next.rend());
+        }
+    }
+
+    // Places the top `height` levels below `root`. The roots of the bottom
+    // subtrees are found level by level rather than recursively, since lists
+    // and degenerate trees can be very deep. Nodes shared by several parents
+    // are walked once, and subtrees whose root is already placed are skipped,
+    // so that DAGs take polynomial rather than exponential time.
+    template <typename T, typename Fields>
+    void van_emde_boas_order(ptr<T> root, std::size_t height, Fields const& fields, ptr_interner<T>& order) {
+        if (order.contains(root)) return;
+        if (height == 1) {
+            order.intern(root);
+            return;
+        }
+        auto const top = height / 2;
+        van_emde_boas_order(root, top, fields, order);
+
+        ptr_interner<T> seen;
+        seen.intern(root);
+        std::vector<ptr<T>> level = { root };
+        std::vector<ptr<T>> next;
+        for (std::size_t depth = 0; depth != top and not level.empty(); ++depth) {
+            next.clear();
+            for (auto node : level) {
+                fields.visit(*node, [&](ptr<T>& field) {
+                    if (field == nullptr or seen.contains(field)) return;
+                    seen.intern(field);
+                    next.push_back(field);
+                });
+            }
+            level.swap(next);
+        }
+        for (auto node : level) van_emde_boas_order(node, height - top, fields, order);
+    }
+} // namespace detail
+
+// Marks the nodes reachable from the roots in `[roots_first, roots_last)`,
+// copies them into a new arena in breadth-first order, so that nodes close in
+// the graph end up close in memory, and rewrites all `ptr` fields of the
+// copies, as well as the roots, to point into the arena. Returns the arena,
+// whose storage (and so every rewritten pointer) is stable under moves.
+template <typename T, typename Fields = ptr_fields<T>>
+std::vector<T> compact(ptr<T>* roots_first, ptr<T>* roots_last, Fields const& fields = Fields()) {
+    ptr_interner<T> order;
+    detail::breadth_first_order(roots_first, roots_last, fields, order);
+    return detail::relocate(order, roots_first, roots_last, fields);
+}
+
+template <typename T, typename Fields = ptr_fields<T>>
+std::vector<T> compact(ptr<T>& root, Fields const& fields = Fields()) {
+    return compact(&root, &root + 1, fields);
+}
+
+enum class layout_order {
+    // Level by level: good for scans and for traversals by level.
+    breadth_first,
+    // Preorder, children in field order: every subtree is contiguous.
+    depth_first,
+    // Recursive blocking by height (van Emde Boas layout): a tree of height h
+    // is stored as its top h / 2 levels followed by the subtrees below them,
+    // each laid out the same way. Root-to-leaf paths touch O(log_B n) cache
+    // blocks for every block size B.
+    van_emde_boas
+};
+
+// Copies the tree at `root` into a new arena in the given order and fixes up
+// its `ptr` fields and `root`, like `compact`. Meant for read-mostly trees;
+// in other graphs, each node is placed where the order first reaches it.
+template <typename T, typename Fields>
+std::vector<T> relayout(ptr<T>& root, Fields const& fields, layout_order order) {
+    ptr_interner<T> placement;
+    switch (order) {
+        case layout_order::breadth_first:
+            detail::breadth_first_order(&root, &root + 1, fields, placement);
+            break;
+        case layout_order::depth_first:
+            detail::depth_first_order(root, fields, placement);
+            break;
+        case layout_order::van_emde_boas:
+            if (root != nullptr) {
+                ptr_interner<T> levels;
+                auto const height = detail::breadth_first_order(&root, &root + 1, fields, levels);
+                placement.reserve(levels.size());
+                detail::van_emde_boas_order(root, height, fields, placement);
+                // Outside trees, paths can be longer than the breadth-first
+                // height; nodes only reached that way go last.
+                for (auto p : levels) placement.intern(p);
+            }
+            break;
+    }
+    return detail::relocate(placement, &root, &root + 1, fields);
+}
+
+template <typename T>
+std::vector<T> relayout(ptr<T>& root, layout_order order) {
+    return relayout(root, ptr_fields<T>(), order);
+}
+
+} // namespace base
+
+#endif // ndef BASE_RELOCATE_HPP
@@ -0,0 +1,191 @@
+#ifndef BASE_SLOT_MAP_HPP
+#define BASE_SLOT_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "ptr.hpp"
+
+namespace base {
+
+// Stable 64-bit handle into a `slot_map`: a slot index plus the generation of
+// that slot at insertion time. A handle whose slot has since been erased (and
+// possibly reused) no longer resolves. Slots never use generation 0, so a
+// default-constructed handle never resolves either.
+class slot_handle {
+public:
+    constexpr slot_handle() noexcept : bits(0) { }
+
+    constexpr std::uint64_t value() const noexcept { return bits; }
+
+    static constexpr slot_handle from_value(std::uint64_t value) noexcept {
+        return slot_handle(value);
+    }
+
+    constexpr std::uint32_t index() const noexcept {
+        return static_cast<std::uint32_t>(bits);
+    }
+
+    constexpr std::uint32_t generation() const noexcept {
+        return static_cast<std::uint32_t>(bits >> 32);
+    }
+
+    friend constexpr bool operator ==(slot_handle lhs, slot_handle rhs) noexcept {
+        return lhs.bits == rhs.bits;
+    }
+
+    friend constexpr bool operator !=(slot_handle lhs, slot_handle rhs) noexcept {
+        return lhs.bits != rhs.bits;
+    }
+
+private:
+    template <typename T>
+    friend class slot_map;
+
+    constexpr explicit slot_handle(std::uint64_t bits) noexcept : bits(bits) { }
+
+    constexpr slot_handle(std::uint32_t index, std::uint32_t generation) noexcept
+        : bits(static_cast<std::uint64_t>(generation) << 32 | index) { }
+
+    std::uint64_t bits;
+};
+
+// Dense slot map: values live contiguously (iteration is a linear scan),
+// insertion and erasure are O(1), and stale handles are detected instead of
+// dangling. Erasure moves the last value into the hole, so pointers returned
+// by `resolve` are only valid until the next insertion or erasure.
+template <typename T>
+class slot_map {
+public:
+    using value_type = T;
+    using handle = slot_handle;
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    handle insert(T const& value) { return emplace(value); }
+
+    handle insert(T&& value) { return emplace(std::move(value)); }
+
+    // If constructing the value or growing storage throws, the map is left
+    // unchanged: all allocation happens before the bookkeeping is updated.
+    template <typename... Args>
+    handle emplace(Args&&... args) {
+        if (free_head == npos) make_room(slots);
+        make_room(owners);
+        values.emplace_back(std::forward<Args>(args)...);
+
+        std::uint32_t index;
+        if (free_head != npos) {
+            index = free_head;
+            free_head = slots[index].target;
+        } else {
+            index = static_cast<std::uint32_t>(slots.size());
+            slots.push_back(slot{0, 1});
+        }
+        owners.push_back(index);
+        slots[index].target = static_cast<std::uint32_t>(values.size() - 1);
+        return handle(index, slots[index].generation);
+    }
+
+    ptr<T> resolve(handle h) noexcept {
+        return contains(h) ? raw_ptr(&values[slots[h.index()].target]) : nullptr;
+    }
+
+    ptr<T const> resolve(handle h) const noexcept {
+        return contains(h) ? raw_ptr(&values[slots[h.index()].target]) : nullptr;
+    }
+
+    bool contains(handle h) const noexcept {
+        return h.index() < slots.size() and
+            slots[h.index()].generation == h.generation() and
+            live(h.index());
+    }
+
+    bool erase(handle h) {
+        if (not contains(h)) return false;
+
+        auto& s = slots[h.index()];
+        auto const hole = s.target;
+        auto const last = static_cast<std::uint32_t>(values.size() - 1);
+        if (hole != last) {
+            values[hole] = std::move(values[last]);
+            owners[hole] = owners[last];
+            slots[owners[hole]].target = hole;
+        }
+        values.pop_back();
+        owners.pop_back();
+
+        next_generation(s);
+        s.target = free_head;
+        free_head = h.index();
+        return true;
+    }
+
+    void clear() noexcept {
+        for (auto index : owners) {
+            next_generation(slots[index]);
+            slots[index].target = free_head;
+            free_head = index;
+        }
+        values.clear();
+        owners.clear();
+    }
+
+    void reserve(std::size_t n) {
+        values.reserve(n);
+        owners.reserve(n);
+        slots.reserve(n);
+    }
+
+    std::size_t size() const noexcept { return values.size(); }
+
+    bool empty() const noexcept { return values.empty(); }
+
+    iterator begin() noexcept { return values.begin(); }
+    iterator end() noexcept { return values.end(); }
+    const_iterator begin() const noexcept { return values.begin(); }
+    const_iterator end() const noexcept { return values.end(); }
+
+    T* data() noexcept { return values.data(); }
+    T const* data() const noexcept { return values.data(); }
+
+private:
+    static constexpr std::uint32_t npos = ~std::uint32_t();
+
+    // For live slots, `target` is the index into `values`; for free slots it
+    // links to the next free slot.
+    struct slot {
+        std::uint32_t target;
+        std::uint32_t generation;
+    };
+
+    // Skips generation 0 when wrapping around, to keep `slot_handle()` free.
+    static void next_generation(slot& s) noexcept {
+        if (++s.generation == 0) s.generation = 1;
+    }
+
+    // Grows `v` geometrically, like `push_back`, so that one more element
+    // can then be appended without allocating.
+    template <typename V>
+    static void make_room(V& v) {
+        if (v.size() == v.capacity()) v.reserve(v.empty() ? 4 : 2 * v.size());
+    }
+
+    bool live(std::uint32_t index) const noexcept {
+        auto const target = slots[index].target;
+        return target < owners.size() and owners[target] == index;
+    }
+
+    std::vector<T> values;
+    std::vector<std::uint32_t> owners;
+    std::vector<slot> slots;
+    std::uint32_t free_head = npos;
+};
+
+template <typename T>
+constexpr std::uint32_t slot_map<T>::npos;
+
+} // namespace base
+
+#endif // ndef BASE_SLOT_MAP_HPP
@@ -0,0 +1,123 @@
+#ifndef BASE_SORTED_PTR_SET_HPP
+#define BASE_SORTED_PTR_SET_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+#include "ptr.hpp"
+#include "ptr_algorithm.hpp"
+
+namespace base {
+
+enum class ptr_set_layout {
+    // Ascending order, searched by branchless binary search.
+    sorted,
+    // Breadth-first order of the implicit search tree (Eytzinger layout): the
+    // first levels of every search share cache lines, and the next nodes to
+    // visit are adjacent.
+    eytzinger
+};
+
+// Immutable set of `ptr<T>` in a contiguous array, ordered by `operator <`
+// (so `nullptr` is the smallest element). Sets of at most `linear_limit`
+// elements are searched by a vectorised linear scan (see `base::find`).
+template <typename T, ptr_set_layout Layout = ptr_set_layout::sorted>
+class sorted_ptr_set {
+public:
+    using value_type = ptr<T>;
+    using const_iterator = typename std::vector<ptr<T>>::const_iterator;
+
+    static constexpr std::size_t linear_limit = 16;
+
+    sorted_ptr_set() = default;
+
+    template <typename InputIt>
+    sorted_ptr_set(InputIt first, InputIt last) : elements(first, last) {
+        std::sort(elements.begin(), elements.end());
+        elements.erase(std::unique(elements.begin(), elements.end()), elements.end());
+        if (Layout == ptr_set_layout::eytzinger and elements.size() > linear_limit) {
+            to_eytzinger();
+        }
+    }
+
+    sorted_ptr_set(std::initializer_list<ptr<T>> values)
+        : sorted_ptr_set(values.begin(), values.end()) { }
+
+    bool contains(ptr<T> p) const noexcept {
+        if (elements.size() <= linear_limit) return scan(p);
+        return Layout == ptr_set_layout::eytzinger ? eytzinger_search(p) : binary_search(p);
+    }
+
+    std::size_t count(ptr<T> p) const noexcept { return contains(p); }
+
+    std::size_t size() const noexcept { return elements.size(); }
+
+    bool empty() const noexcept { return elements.empty(); }
+
+    // Elements in storage order, which is ascending except for the Eytzinger
+    // layout.
+    const_iterator begin() const noexcept { return elements.begin(); }
+    const_iterator end() const noexcept { return elements.end(); }
+
+private:
+    bool scan(ptr<T> p) const noexcept {
+        auto const first = elements.data();
+        auto const last = first + elements.size();
+        return find(first, last, p) != last;
+    }
+
+    bool binary_search(ptr<T> p) const noexcept {
+        auto first = elements.data();
+        auto n = elements.size();
+        while (n > 1) {
+            auto const half = n / 2;
+            first += (first[half - 1] < p) * half;
+            n -= half;
+        }
+        return *first == p;
+    }
+
+    // Node k in [1, n] of the implicit search tree is stored at index k - 1;
+    // its children are nodes 2k and 2k + 1.
+    bool eytzinger_search(ptr<T> p) const noexcept {
+        auto const tree = elements.data();
+        auto const n = elements.size();
+        std::size_t k = 1;
+        while (k <= n) {
+#ifdef __GNUC__
+            // The 16 descendants four levels down share two cache lines.
+            __builtin_prefetch(tree + 16 * k - 1);
+#endif
+            k = 2 * k + (tree[k - 1] < p);
+        }
+        // Undo the final right turns, and the left turn before them, to get
+        // back to the smallest element not less than `p`.
+        while (k & 1) k >>= 1;
+        k >>= 1;
+        return k != 0 and tree[k - 1] == p;
+    }
+
+    void to_eytzinger() {
+        std::vector<ptr<T>> tree(elements.size());
+        auto next = elements.cbegin();
+        fill_eytzinger(tree, next, 1);
+        elements.swap(tree);
+    }
+
+    void fill_eytzinger(std::vector<ptr<T>>& tree, const_iterator& next, std::size_t k) {
+        if (k > tree.size()) return;
+        fill_eytzinger(tree, next, 2 * k);
+        tree[k - 1] = *next++;
+        fill_eytzinger(tree, next, 2 * k + 1);
+    }
+
+    std::vector<ptr<T>> elements;
+};
+
+template <typename T, ptr_set_layout Layout>
+constexpr std::size_t sorted_ptr_set<T, Layout>::linear_limit;
+
+} // namespace base
+
+#endif // ndef BASE_SORTED_PTR_SET_HPP
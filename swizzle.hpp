@@ -0,0 +1,208 @@
+#ifndef BASE_SWIZZLE_HPP
+#define BASE_SWIZZLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "io_error.hpp"
+#include "ptr.hpp"
+#include "ptr_fields.hpp"
+
+namespace base {
+
+// On-disk image of a graph of `T` nodes linked by `ptr<T>` fields (as
+// enumerated by `ptr_fields<T>`). Nodes are stored contiguously in breadth-
+// first order behind a fixed-size header; each `ptr` field is swizzled into
+// the word `index + 1` of its target, with 0 standing for `nullptr`.
+struct graph_file_header {
+    char magic[8];
+    std::uint64_t version;
+    std::uint64_t node_size;
+    std::uint64_t node_align;
+    std::uint64_t count;
+    std::uint64_t root;
+    std::uint64_t reserved[2];
+};
+
+namespace detail {
+    static_assert(sizeof(graph_file_header) == 64, "Unexpected header padding");
+
+    constexpr char graph_file_magic[8] = { 'b', 'a', 's', 'e', 'g', 'r', 'p', 'h' };
+    constexpr std::uint64_t graph_file_version = 1;
+
+    template <typename T>
+    inline std::uintptr_t ptr_word(ptr<T> const& field) noexcept {
+        std::uintptr_t word;
+        std::memcpy(&word, &field, sizeof word);
+        return word;
+    }
+
+    template <typename T>
+    inline void set_ptr_word(ptr<T>& field, std::uintptr_t word) noexcept {
+        std::memcpy(static_cast<void*>(&field), &word, sizeof word);
+    }
+
+    template <typename T>
+    inline void check_swizzlable() noexcept {
+        static_assert(std::is_trivially_copyable<T>::value,
+            "Swizzled nodes are copied bytewise and must be trivially copyable");
+        static_assert(alignof(T) <= sizeof(graph_file_header),
+            "Node alignment exceeds the graph file header size");
+        static_assert(sizeof(ptr<T>) == sizeof(std::uintptr_t),
+            "ptr is expected to be a bare pointer word");
+    }
+} // namespace detail
+
+// Writes the graph reachable from `root` to `path`. Returns the number of
+// nodes written.
+template <typename T>
+std::size_t write_graph(std::string const& path, ptr<T const> root) {
+    detail::check_swizzlable<T>();
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) throw detail::io_error(path);
+
+    std::unordered_map<T const*, std::uintptr_t> index;
+    std::deque<T const*> queue;
+    auto const lookup = [&](T const* target) {
+        auto const result = index.emplace(target, index.size());
+        if (result.second) queue.push_back(target);
+        return result.first->second;
+    };
+
+    graph_file_header header = { };
+    std::memcpy(header.magic, detail::graph_file_magic, sizeof header.magic);
+    header.version = detail::graph_file_version;
+    header.node_size = sizeof(T);
+    header.node_align = alignof(T);
+    header.root = root == nullptr ? 0 : lookup(root.get()) + 1;
+
+    bool ok = std::fwrite(&header, sizeof header, 1, file) == 1;
+
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type buffer;
+    while (ok and not queue.empty()) {
+        std::memcpy(&buffer, queue.front(), sizeof(T));
+        queue.pop_front();
+        ptr_fields<T>::visit(*reinterpret_cast<T*>(&buffer), [&](ptr<T>& field) {
+            detail::set_ptr_word(field, field == nullptr ? 0 : lookup(field.get()) + 1);
+        });
+        ok = std::fwrite(&buffer, sizeof(T), 1, file) == 1;
+        ++header.count;
+    }
+
+    ok = ok and std::fseek(file, 0, SEEK_SET) == 0 and
+        std::fwrite(&header, sizeof header, 1, file) == 1;
+    ok = std::fclose(file) == 0 and ok;
+    if (not ok) throw detail::io_error(path);
+    return header.count;
+}
+
+template <typename T>
+inline std::size_t write_graph(std::string const& path, ptr<T> root) {
+    return write_graph<T>(path, ptr<T const>(root));
+}
+
+// Graph loaded from a file written by `write_graph`. The file is mapped
+// privately (so the file itself is never modified) and all `ptr` fields are
+// unswizzled in a single sequential pass over the mapping, after which the
+// nodes are ordinary `ptr`-linked objects that live as long as this object.
+template <typename T>
+class mapped_graph {
+public:
+    explicit mapped_graph(std::string const& path) {
+        detail::check_swizzlable<T>();
+
+        int const fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) throw detail::io_error(path);
+
+        struct stat info;
+        if (::fstat(fd, &info) == -1) {
+            auto error = detail::io_error(path);
+            ::close(fd);
+            throw error;
+        }
+
+        length = static_cast<std::size_t>(info.st_size);
+        if (length < sizeof(graph_file_header)) {
+            ::close(fd);
+            throw std::runtime_error(path + ": not a graph file");
+        }
+
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        flags |= MAP_POPULATE;
+#endif
+        void* const address = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED) throw detail::io_error(path);
+        mapping = address;
+
+        try {
+            unswizzle(path);
+        } catch (...) {
+            ::munmap(mapping, length);
+            throw;
+        }
+    }
+
+    mapped_graph(mapped_graph const&) = delete;
+    mapped_graph& operator =(mapped_graph const&) = delete;
+
+    ~mapped_graph() { ::munmap(mapping, length); }
+
+    ptr<T> root() const noexcept { return root_node; }
+
+    std::size_t size() const noexcept { return count; }
+
+    // Nodes in breadth-first order from the root.
+    T* begin() const noexcept { return nodes; }
+    T* end() const noexcept { return nodes + count; }
+
+private:
+    void unswizzle(std::string const& path) {
+        auto const& header = *static_cast<graph_file_header const*>(mapping);
+        auto const available = (length - sizeof header) / sizeof(T);
+        if (std::memcmp(header.magic, detail::graph_file_magic, sizeof header.magic) != 0 or
+                header.version != detail::graph_file_version or
+                header.node_size != sizeof(T) or header.node_align != alignof(T) or
+                header.count > available or header.root > header.count) {
+            throw std::runtime_error(path + ": incompatible graph file");
+        }
+
+        count = static_cast<std::size_t>(header.count);
+        nodes = reinterpret_cast<T*>(static_cast<char*>(mapping) + sizeof header);
+        root_node = header.root == 0 ? nullptr : raw_ptr(nodes + (header.root - 1));
+
+        T* const first = nodes;
+        std::uintptr_t const limit = count;
+        bool valid = true;
+        for (auto node = first; node != first + count; ++node) {
+            ptr_fields<T>::visit(*node, [&](ptr<T>& field) {
+                auto const word = detail::ptr_word(field);
+                valid = valid and word <= limit;
+                field = word == 0 or word > limit ? nullptr : raw_ptr(first + (word - 1));
+            });
+        }
+        if (not valid) throw std::runtime_error(path + ": corrupt graph file");
+    }
+
+    void* mapping = nullptr;
+    std::size_t length = 0;
+    T* nodes = nullptr;
+    std::size_t count = 0;
+    ptr<T> root_node = nullptr;
+};
+
+} // namespace base
+
+#endif // ndef BASE_SWIZZLE_HPP
@@ -1,18 +1,53 @@
 #include <type_traits>
 #include <string>
 #include <utility>
+#include <iterator>
+#include <cstdio>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <new>
 
 #define CATCH_CONFIG_MAIN
 #define CATCH_CONFIG_CPP11_NULLPTR
 #include "catch.hpp"
 
 #include "ptr.hpp"
+#include "ptr_traits.hpp"
+#include "weak_observer.hpp"
+#include "slot_map.hpp"
+#include "swizzle.hpp"
+#include "lazy_ptr.hpp"
+#include "ptr_trace.hpp"
+#include "ptr_io.hpp"
+#include "binary_trace.hpp"
+#include "ptr_symbol.hpp"
+#include "sorted_ptr_set.hpp"
+#include "radix_sort.hpp"
+#include "ptr_algorithm.hpp"
+#include "gather.hpp"
+#include "ptr_interner.hpp"
+#include "ptr_queue.hpp"
+#include "work_stealing.hpp"
+#include "intrusive_list.hpp"
+#include "graph_traversal.hpp"
+#include "relocate.hpp"
+#include "packed_ptr_array.hpp"
 
 using base::ptr;
 using base::raw_ptr;
 using base::static_pointer_cast;
 using base::dynamic_pointer_cast;
 using base::const_pointer_cast;
+using base::weak_observer;
+using base::slot_map;
 
 TEST_CASE("init", "Test pointer initialisation") {
     ptr<int> p1;
@@ -157,6 +192,7 @@ TEST_CASE("const_cast", "Casting") {
 TEST_CASE("auto-generated", "Test whether auto-generated members work") {
     ptr<int> a = nullptr;
     ptr<int> b;
+    (void) b;
     // N.B.: Since ptr is a trivial type, we do not expect `a == b`.
     ptr<int> c(a);
     ptr<int> d(std::move(d));
@@ -188,3 +224,1397 @@ TEST_CASE("pointer_traits", "Traits") {
             pointer_traits<float*>::rebind<double>,
             pointer_traits<ptr<float>>::rebind<double>::pointer>::value, "Rebind types unequal");
 }
+
+TEST_CASE("weak_observer", "Observe an intrusively invalidated object") {
+    struct entry : base::observable<> { int value; };
+
+    entry e;
+    e.value = 42;
+
+    weak_observer<entry> empty;
+    REQUIRE(empty.lock() == nullptr);
+    REQUIRE(empty.expired());
+
+    weak_observer<entry> w = raw_ptr(&e);
+    REQUIRE(w.lock() == raw_ptr(&e));
+    REQUIRE(w.lock()->value == 42);
+    REQUIRE(w.validate());
+
+    e.invalidate();
+    REQUIRE(w.lock() == nullptr);
+    REQUIRE(w.expired());
+
+    // A new observer sees the recycled object.
+    weak_observer<entry> w2 = raw_ptr(&e);
+    REQUIRE(w2.lock() == raw_ptr(&e));
+    REQUIRE(w.lock() == nullptr);
+
+    entry copy = e;
+    weak_observer<entry> wc = raw_ptr(&copy);
+    copy.invalidate();
+    REQUIRE(wc.expired());
+    REQUIRE(not w2.expired());
+
+    // An object reconstructed in recycled storage continues the generation,
+    // so observers of the previous occupant do not see it.
+    struct pooled : base::observable<> {
+        pooled() = default;
+        explicit pooled(base::generation_t retired) : observable(retired) { }
+    };
+    std::aligned_storage<sizeof(pooled), alignof(pooled)>::type slot;
+    auto first = raw_ptr(new (&slot) pooled());
+    weak_observer<pooled> old = first;
+    REQUIRE(old.validate());
+    auto const retired = first->retire();
+    first->~pooled();
+    auto second = raw_ptr(new (&slot) pooled(retired));
+    REQUIRE(old.lock() == nullptr);
+    REQUIRE(not old.validate());
+    weak_observer<pooled> fresh = second;
+    REQUIRE(fresh.lock() == second);
+    second->~pooled();
+}
+
+TEST_CASE("weak_observer seqlock", "Sequence-locked observation") {
+    struct entry : base::observable<base::sequence_locked> { int value; };
+
+    entry e;
+    e.value = 1;
+
+    weak_observer<entry> w = raw_ptr(&e);
+    ptr<entry> p = w.lock();
+    REQUIRE(p != nullptr);
+    REQUIRE(p->value == 1);
+    REQUIRE(w.validate());
+
+    e.begin_invalidate();
+    // Observers neither lock nor validate during an invalidation.
+    REQUIRE(w.lock() == nullptr);
+    REQUIRE(not w.validate());
+    weak_observer<entry> during = raw_ptr(&e);
+    REQUIRE(during.lock() == nullptr);
+    e.end_invalidate();
+
+    REQUIRE(w.lock() == nullptr);
+    REQUIRE(not w.validate());
+    REQUIRE(during.lock() == nullptr);
+
+    weak_observer<entry> after = raw_ptr(&e);
+    REQUIRE(after.lock() == raw_ptr(&e));
+}
+
+TEST_CASE("slot_map", "Generational handles") {
+    slot_map<int> map;
+
+    auto h1 = map.insert(1);
+    // The all-zero handle never names a slot, not even the first one.
+    REQUIRE(h1 != base::slot_handle());
+    REQUIRE(map.resolve(base::slot_handle()) == nullptr);
+    auto h2 = map.insert(2);
+    auto h3 = map.insert(3);
+    REQUIRE(map.size() == 3);
+    REQUIRE(*map.resolve(h1) == 1);
+    REQUIRE(*map.resolve(h2) == 2);
+    REQUIRE(*map.resolve(h3) == 3);
+
+    REQUIRE(map.erase(h1));
+    REQUIRE(not map.erase(h1));
+    REQUIRE(map.resolve(h1) == nullptr);
+    REQUIRE(*map.resolve(h2) == 2);
+    REQUIRE(*map.resolve(h3) == 3);
+
+    // The freed slot is reused, but the stale handle stays a miss.
+    auto h4 = map.insert(4);
+    REQUIRE(h4.index() == h1.index());
+    REQUIRE(h4 != h1);
+    REQUIRE(map.resolve(h1) == nullptr);
+    REQUIRE(*map.resolve(h4) == 4);
+
+    int sum = 0;
+    for (int value : map) sum += value;
+    REQUIRE(sum == 9);
+    REQUIRE(std::distance(map.begin(), map.end()) == 3);
+
+    auto copy = base::slot_handle::from_value(h4.value());
+    REQUIRE(copy == h4);
+
+    map.clear();
+    REQUIRE(map.empty());
+    REQUIRE(map.resolve(h2) == nullptr);
+    REQUIRE(map.resolve(h4) == nullptr);
+    REQUIRE(map.resolve(base::slot_handle()) == nullptr);
+
+    // A throwing constructor leaves the map as it was.
+    struct fragile {
+        explicit fragile(bool fail) : value(1) { if (fail) throw std::runtime_error("fragile"); }
+        int value;
+    };
+    slot_map<fragile> fragiles;
+    auto f1 = fragiles.emplace(false);
+    REQUIRE_THROWS(fragiles.emplace(true));
+    REQUIRE(fragiles.size() == 1);
+    REQUIRE(fragiles.resolve(f1)->value == 1);
+    auto f2 = fragiles.emplace(false);
+    REQUIRE(f2.index() == 1);
+    REQUIRE(fragiles.erase(f1));
+    REQUIRE_THROWS(fragiles.emplace(true));
+    auto f3 = fragiles.emplace(false);
+    REQUIRE(f3.index() == f1.index());
+    REQUIRE(fragiles.resolve(f1) == nullptr);
+    REQUIRE(fragiles.resolve(f2) != nullptr);
+    REQUIRE(fragiles.resolve(f3) != nullptr);
+}
+
+namespace {
+    struct tree_node {
+        int value;
+        ptr<tree_node> left;
+        ptr<tree_node> right;
+    };
+} // namespace
+
+namespace base {
+    template <>
+    struct ptr_fields<tree_node> {
+        template <typename F>
+        static void visit(tree_node& node, F&& f) {
+            f(node.left);
+            f(node.right);
+        }
+    };
+} // namespace base
+
+TEST_CASE("swizzle", "Write and map a ptr-linked graph") {
+    tree_node nodes[5] = { };
+    for (int i = 0; i < 5; ++i) nodes[i].value = i;
+    nodes[0].left = raw_ptr(&nodes[1]);
+    nodes[0].right = raw_ptr(&nodes[2]);
+    nodes[1].left = raw_ptr(&nodes[3]);
+    nodes[2].right = raw_ptr(&nodes[4]);
+    // Shared and cyclic edges are preserved.
+    nodes[3].right = raw_ptr(&nodes[4]);
+    nodes[4].left = raw_ptr(&nodes[0]);
+
+    char const* path = "swizzle_test.bin";
+    REQUIRE(base::write_graph(path, raw_ptr(&nodes[0])) == 5);
+
+    {
+        base::mapped_graph<tree_node> graph(path);
+        REQUIRE(graph.size() == 5);
+
+        ptr<tree_node> root = graph.root();
+        REQUIRE(root->value == 0);
+        REQUIRE(root->left->value == 1);
+        REQUIRE(root->right->value == 2);
+        REQUIRE(root->left->left->value == 3);
+        REQUIRE(root->left->right == nullptr);
+        REQUIRE(root->right->right->value == 4);
+        REQUIRE(root->left->left->right == root->right->right);
+        REQUIRE(root->right->right->left == root);
+        REQUIRE(raw_ptr(graph.begin()) == root);
+    }
+
+    REQUIRE(base::write_graph(path, ptr<tree_node>(nullptr)) == 0);
+    {
+        base::mapped_graph<tree_node> graph(path);
+        REQUIRE(graph.size() == 0);
+        REQUIRE(graph.root() == nullptr);
+    }
+
+    std::remove(path);
+    REQUIRE_THROWS(base::mapped_graph<tree_node>{path});
+}
+
+namespace {
+    int lazy_objects[4] = { 10, 11, 12, 13 };
+    int lazy_resolutions = 0;
+
+    struct lazy_resolver {
+        ptr<int> operator ()(std::uintptr_t id) const {
+            ++lazy_resolutions;
+            return id < 4 ? raw_ptr(&lazy_objects[id]) : nullptr;
+        }
+    };
+
+    // Not default-constructible: only usable through `get(resolver)`.
+    struct table_resolver {
+        std::vector<int>& objects;
+        std::size_t calls;
+
+        ptr<int> operator ()(std::uintptr_t id) {
+            ++calls;
+            return id < objects.size() ? raw_ptr(&objects[id]) : nullptr;
+        }
+    };
+} // namespace
+
+TEST_CASE("lazy_ptr", "Resolve on first dereference") {
+    using lazy = base::lazy_ptr<int, lazy_resolver>;
+    lazy_resolutions = 0;
+
+    lazy null;
+    REQUIRE(null.resolved());
+    REQUIRE(null.get() == nullptr);
+
+    lazy direct = raw_ptr(&lazy_objects[0]);
+    REQUIRE(direct.resolved());
+    REQUIRE(*direct == 10);
+
+    lazy p = lazy::unresolved(2);
+    REQUIRE(not p.resolved());
+    REQUIRE(p.id() == 2);
+    REQUIRE(p.peek() == nullptr);
+    REQUIRE(lazy_resolutions == 0);
+
+    lazy copy = p;
+    REQUIRE(*p == 12);
+    REQUIRE(p.resolved());
+    REQUIRE(p.peek() == raw_ptr(&lazy_objects[2]));
+    REQUIRE(lazy_resolutions == 1);
+
+    REQUIRE(*p == 12);
+    ptr<int> resolved = p;
+    REQUIRE(resolved == raw_ptr(&lazy_objects[2]));
+    REQUIRE(lazy_resolutions == 1);
+
+    // Copies resolve independently.
+    REQUIRE(not copy.resolved());
+    REQUIRE(copy.get() == resolved);
+    REQUIRE(lazy_resolutions == 2);
+
+    lazy missing = lazy::unresolved(lazy::max_id);
+    REQUIRE(missing.id() == lazy::max_id);
+    REQUIRE(missing.get() == nullptr);
+    REQUIRE(missing.resolved());
+
+    using table_lazy = base::lazy_ptr<int, table_resolver>;
+    std::vector<int> table = { 20, 21 };
+    table_resolver resolver{table, 0};
+    table_lazy q = table_lazy::unresolved(1);
+    REQUIRE(q.get(resolver) == raw_ptr(&table[1]));
+    REQUIRE(q.get(resolver) == raw_ptr(&table[1]));
+    REQUIRE(q.peek() == raw_ptr(&table[1]));
+    REQUIRE(resolver.calls == 1);
+}
+
+TEST_CASE("ptr_trace", "Aggregate sampled dereferences") {
+    namespace trace = base::trace;
+
+    int values[20] = { };
+    trace::clear();
+    trace::set_sample_period(1);
+    trace::register_site(values, sizeof values, "values");
+
+    for (int i = 0; i < 3; ++i) trace::record(&values[0]);
+    trace::record(&values[19]);
+    int other;
+    trace::record(&other);
+
+    auto const profile = trace::aggregate();
+    REQUIRE(profile.samples == 5);
+    REQUIRE(profile.by_address.size() == 3);
+    REQUIRE(profile.by_address[0].first == reinterpret_cast<std::uintptr_t>(&values[0]));
+    REQUIRE(profile.by_address[0].second == 3);
+    REQUIRE(profile.by_site.size() == 2);
+    REQUIRE(profile.by_site[0].first == "values");
+    REQUIRE(profile.by_site[0].second == 4);
+    REQUIRE(profile.by_site[1].first == "<unknown>");
+    REQUIRE(profile.by_site[1].second == 1);
+
+    trace::set_sample_period(2);
+    trace::clear();
+    for (int i = 0; i < 4; ++i) trace::record(&other);
+    REQUIRE(trace::aggregate().samples == 2);
+
+    // Exited threads leave their samples behind and hand their buffer on to
+    // the next thread.
+    trace::set_sample_period(1);
+    trace::clear();
+    auto const buffers = [] {
+        std::size_t n = 0;
+        for (auto node = trace::detail::global().buffers; node != nullptr; node = node->next) ++n;
+        return n;
+    };
+    auto const before = buffers();
+    for (int i = 0; i < 8; ++i) std::thread([&other] { trace::record(&other); }).join();
+    REQUIRE(buffers() <= before + 1);
+    REQUIRE(trace::aggregate().samples == 8);
+
+    // Clearing from another thread does not wait for the owners.
+    std::thread([] { trace::clear(); }).join();
+    REQUIRE(trace::aggregate().samples == 0);
+    trace::record(&other);
+    REQUIRE(trace::aggregate().samples == 1);
+
+    trace::unregister_site(values);
+    trace::set_sample_period(BASE_PTR_TRACE_SAMPLE_PERIOD);
+    trace::clear();
+}
+
+#ifdef BASE_PTR_TRACE
+TEST_CASE("ptr_trace deref", "Traced builds record dereferences") {
+    namespace trace = base::trace;
+
+    struct pair_t { int first; int second; } x = { 1, 2 };
+    ptr<pair_t> px = raw_ptr(&x);
+
+    trace::clear();
+    trace::set_sample_period(1);
+    REQUIRE(px->first == 1);
+    REQUIRE((*px).second == 2);
+
+    auto const profile = trace::aggregate();
+    REQUIRE(profile.by_address.size() == 1);
+    REQUIRE(profile.by_address[0].first == reinterpret_cast<std::uintptr_t>(&x));
+    REQUIRE(profile.by_address[0].second == 2);
+
+    trace::set_sample_period(BASE_PTR_TRACE_SAMPLE_PERIOD);
+    trace::clear();
+}
+#endif
+
+TEST_CASE("format_hex", "Fixed-width pointer formatting") {
+    REQUIRE(base::format_hex(ptr<int>(nullptr)).str() ==
+        "0x" + std::string(2 * sizeof(void*), '0'));
+
+    int x;
+    ptr<int> px = raw_ptr(&x);
+    auto const address = reinterpret_cast<std::uintptr_t>(&x);
+
+    std::ostringstream expected;
+    expected << "0x" << std::hex;
+    expected.width(2 * sizeof(void*));
+    expected.fill('0');
+    expected << address;
+
+    auto const formatted = base::format_hex(px);
+    REQUIRE(formatted.size() == base::hex_ptr_width);
+    REQUIRE(std::string(formatted.c_str()) == expected.str());
+
+    char buffer[64];
+    auto result = base::to_chars(buffer, buffer + sizeof buffer, px);
+    REQUIRE(result.ec == std::errc());
+    REQUIRE(std::string(buffer, result.ptr) == expected.str());
+
+    result = base::to_chars(buffer, buffer + base::hex_ptr_width - 1, px);
+    REQUIRE(result.ec == std::errc::value_too_large);
+    REQUIRE(result.ptr == buffer + base::hex_ptr_width - 1);
+
+    std::ostringstream out;
+    out << px;
+    REQUIRE(out.str() == expected.str());
+
+    // Formatting state applies to the pointer and is reset after it.
+    auto const hex = expected.str();
+    auto const pad = std::string(24 - hex.size(), ' ');
+    out.str("");
+    out << std::setw(24) << px << '|';
+    REQUIRE(out.str() == pad + hex + '|');
+    out.str("");
+    out << std::left << std::setw(24) << px << '|';
+    REQUIRE(out.str() == hex + pad + '|');
+    out.str("");
+    out << std::internal << std::setfill('.') << std::setw(24) << px;
+    REQUIRE(out.str() == "0x" + std::string(pad.size(), '.') + hex.substr(2));
+}
+
+TEST_CASE("binary_trace", "Append and read back binary pointer traces") {
+    int values[3];
+    char const* path = "binary_trace_test.bin";
+
+    {
+        base::binary_writer writer(path, 2);
+        for (int i = 0; i < 3; ++i) writer.append(raw_ptr(&values[i]), i);
+        writer.append(ptr<int>(nullptr), 42);
+        writer.append(0x1234, 7);
+        writer.flush();
+        REQUIRE(writer.size() == 5);
+    }
+
+    {
+        base::binary_reader reader(path);
+        REQUIRE(reader.size() == 5);
+        auto record = reader.begin();
+        for (int i = 0; i < 3; ++i, ++record) {
+            REQUIRE(record->value == reinterpret_cast<std::uintptr_t>(&values[i]));
+            REQUIRE(record->tag == static_cast<std::uint64_t>(i));
+        }
+        REQUIRE(record->value == 0);
+        REQUIRE(record->tag == 42);
+        ++record;
+        REQUIRE(record->value == 0x1234);
+        REQUIRE(++record == reader.end());
+    }
+
+    std::remove(path);
+    REQUIRE_THROWS(base::binary_reader{path});
+}
+
+namespace {
+    struct local_shape {
+        virtual ~local_shape() { }
+    };
+} // namespace
+
+TEST_CASE("ptr_symbol", "Symbolize function and vtable pointers") {
+    REQUIRE(base::symbol_name(ptr<int>(nullptr)) == nullptr);
+
+    ptr<void()> f = raw_ptr(&std::abort);
+    char const* name = base::symbol_name(f);
+    REQUIRE(name != nullptr);
+    REQUIRE(std::strstr(name, "abort") != nullptr);
+    // Repeated lookups are served from the cache.
+    REQUIRE(base::symbol_name(f) == name);
+
+    // Addresses without a symbol are not cached, so they cannot crowd out
+    // later symbols.
+    std::vector<int> heap(2 * base::detail::symbol_cache::capacity);
+    for (auto& value : heap) REQUIRE(base::symbol_name(raw_ptr(&value)) == nullptr);
+    ptr<void()> g = raw_ptr(&std::terminate);
+    name = base::symbol_name(g);
+    REQUIRE(name != nullptr);
+    REQUIRE(base::symbol_name(g) == name);
+
+    std::runtime_error error("");
+    ptr<std::exception> pe = raw_ptr(&error);
+    name = base::symbol_name(pe);
+    REQUIRE(name != nullptr);
+    REQUIRE(std::string(name) == "vtable for std::runtime_error");
+
+    std::ostringstream out;
+    out << base::with_symbol(pe);
+    REQUIRE(out.str() == base::format_hex(pe).str() + " <vtable for std::runtime_error>");
+
+    // The test executable's own vtables are not exported; fall back to the
+    // dynamic type's name.
+    local_shape shape;
+    out.str("");
+    out << base::with_symbol(raw_ptr(&shape));
+    REQUIRE(out.str().find("local_shape>") != std::string::npos);
+
+    // Both the missing vtable symbol and the type name are cached by vptr,
+    // so printing the same type again is a hash lookup.
+    auto const vptr = reinterpret_cast<std::uintptr_t>(
+        base::detail::symbol_address(raw_ptr(&shape), std::false_type()));
+    REQUIRE(base::detail::global_symbol_cache().find(vptr, name));
+    REQUIRE(name == nullptr);
+    REQUIRE(base::detail::global_type_name_cache().find(vptr, name));
+    REQUIRE(std::strstr(name, "local_shape") != nullptr);
+    auto const type_name = name;
+    out.str("");
+    out << base::with_symbol(raw_ptr(&shape));
+    REQUIRE(out.str().find("local_shape>") != std::string::npos);
+    REQUIRE(base::detail::global_type_name_cache().find(vptr, name));
+    REQUIRE(name == type_name);
+    REQUIRE(base::symbol_name(raw_ptr(&shape)) == nullptr);
+
+    out.str("");
+    out << base::with_symbol(ptr<int>(nullptr));
+    REQUIRE(out.str() == base::format_hex(ptr<int>(nullptr)).str());
+}
+
+namespace {
+    constexpr int constant_values[3] = { 1, 2, 3 };
+
+    // Constant-initialised: no dynamic initialisation at startup.
+    constexpr ptr<int const> constant_table[] = {
+        base::raw_ptr(&constant_values[0]),
+        nullptr,
+        base::raw_ptr(&constant_values[2])
+    };
+
+    struct constant_base {
+        constexpr constant_base() : value(0) { }
+        int value;
+    };
+    struct constant_derived : constant_base { };
+    constexpr constant_derived constant_object{};
+} // namespace
+
+TEST_CASE("constexpr", "Constant expressions") {
+    static_assert(constant_table[0] == base::raw_ptr(&constant_values[0]), "");
+    static_assert(constant_table[1] == nullptr, "");
+    static_assert(nullptr == constant_table[1], "");
+    static_assert(constant_table[0] != constant_table[2], "");
+    static_assert(constant_table[0] != nullptr, "");
+    static_assert(constant_table[0] < constant_table[2], "");
+    static_assert(constant_table[2] > constant_table[0], "");
+    static_assert(constant_table[0] <= constant_table[0], "");
+    static_assert(constant_table[0] >= constant_table[0], "");
+    static_assert(nullptr < constant_table[0], "");
+    static_assert(constant_table[0].get() == &constant_values[0], "");
+#ifndef BASE_PTR_TRACE
+    // Traced dereferences have side effects.
+    static_assert(*constant_table[2] == 3, "");
+#endif
+
+    constexpr ptr<constant_derived const> pd = base::raw_ptr(&constant_object);
+    constexpr ptr<constant_base const> pb = pd;
+    static_assert(static_pointer_cast<constant_base const>(pd) == pb, "");
+    static_assert(const_pointer_cast<constant_derived>(pd) == pd, "");
+#ifndef BASE_PTR_TRACE
+    static_assert(pb->value == 0, "");
+#endif
+
+    REQUIRE(*constant_table[0] == 1);
+}
+
+template <base::ptr_set_layout Layout>
+static void check_sorted_ptr_set(std::size_t n) {
+    std::vector<int> values(2 * n);
+    std::vector<ptr<int>> members;
+    for (std::size_t i = 0; i < n; ++i) members.push_back(raw_ptr(&values[2 * i]));
+    // Duplicates are ignored.
+    if (n != 0) members.push_back(raw_ptr(&values[0]));
+    std::reverse(members.begin(), members.end());
+
+    base::sorted_ptr_set<int, Layout> set(members.begin(), members.end());
+    REQUIRE(set.size() == n);
+    for (std::size_t i = 0; i < 2 * n; ++i) {
+        REQUIRE(set.contains(raw_ptr(&values[i])) == (i % 2 == 0));
+    }
+    REQUIRE(not set.contains(nullptr));
+}
+
+TEST_CASE("sorted_ptr_set", "Sorted flat pointer sets") {
+    for (std::size_t n : { 0, 1, 2, 3, 4, 5, 16, 17, 100, 1000 }) {
+        check_sorted_ptr_set<base::ptr_set_layout::sorted>(n);
+        check_sorted_ptr_set<base::ptr_set_layout::eytzinger>(n);
+    }
+
+    int x[2];
+    base::sorted_ptr_set<int> set = { raw_ptr(&x[1]), nullptr, raw_ptr(&x[0]) };
+    REQUIRE(set.contains(nullptr));
+    REQUIRE(std::is_sorted(set.begin(), set.end()));
+    REQUIRE(*set.begin() == nullptr);
+    REQUIRE(set.count(raw_ptr(&x[0])) == 1);
+}
+
+TEST_CASE("radix_sort", "Radix sort agrees with operator <") {
+    std::mt19937 random(1);
+    std::vector<long> objects(5000);
+    std::vector<long> others(300);
+    long single;
+
+    for (std::size_t n : { 0, 1, 2, 255, 256, 1000, 20000 }) {
+        std::vector<ptr<long const>> values;
+        for (std::size_t i = 0; i != n; ++i) {
+            switch (random() % 4) {
+                case 0: values.push_back(raw_ptr(&objects[random() % objects.size()])); break;
+                case 1: values.push_back(raw_ptr(&others[random() % others.size()])); break;
+                case 2: values.push_back(raw_ptr(&single)); break;
+                default: values.push_back(nullptr); break;
+            }
+        }
+        auto expected = values;
+        std::sort(expected.begin(), expected.end());
+
+        auto sorted = values;
+        base::radix_sort(sorted.data(), sorted.data() + n);
+        REQUIRE(sorted == expected);
+
+        for (unsigned threads : { 0, 1, 3, 8 }) {
+            sorted = values;
+            base::radix_sort(sorted.data(), sorted.data() + n, threads);
+            REQUIRE(sorted == expected);
+        }
+    }
+}
+
+TEST_CASE("ptr_algorithm", "Vectorised search at every supported SIMD level") {
+    using base::simd_level;
+
+    int objects[4];
+    ptr<int> const a = raw_ptr(&objects[0]);
+    ptr<int> const b = raw_ptr(&objects[1]);
+    ptr<int> const c = raw_ptr(&objects[2]);
+    ptr<int> const d = raw_ptr(&objects[3]);
+
+    for (auto level : { simd_level::scalar, simd_level::sse2, simd_level::avx2, simd_level::avx512 }) {
+        if (level > base::supported_simd_level()) break;
+
+        for (std::size_t n = 0; n != 40; ++n) {
+            std::vector<ptr<int>> values(n, a);
+            auto const first = values.data();
+            auto const last = first + n;
+
+            REQUIRE(base::detail::find(level, first, last, b) == last);
+            REQUIRE(base::detail::count(level, first, last, a) == n);
+            REQUIRE(not base::detail::contains_any(level, first, last, &b, &b + 1));
+
+            for (std::size_t i = 0; i < n; i += 3) values[i] = b;
+            if (n != 0) values[n - 1] = c;
+            std::size_t expected = 0;
+            for (std::size_t i = 0; i != n; ++i) expected += values[i] == b;
+
+            REQUIRE(base::detail::find(level, first, last, b) == (n > 1 ? first : last));
+            REQUIRE(base::detail::find(level, first, last, c) == (n != 0 ? last - 1 : last));
+            REQUIRE(base::detail::count(level, first, last, b) == expected);
+            ptr<int> const needles[] = { d, c };
+            REQUIRE(base::detail::contains_any(level, first, last, needles, needles + 2) == (n != 0));
+            REQUIRE(not base::detail::contains_any(level, first, last, needles, needles + 1));
+            REQUIRE(not base::detail::contains_any(level, first, last, needles, needles));
+        }
+    }
+
+    std::vector<ptr<int>> values = { a, b, nullptr, c, nullptr };
+    auto const first = values.data();
+    auto const last = first + values.size();
+    REQUIRE(base::find(first, last, c) == first + 3);
+    REQUIRE(base::find_null(first, last) == first + 2);
+    REQUIRE(base::count(first, last, ptr<int>(nullptr)) == 2);
+    REQUIRE(base::contains_any(first, last, &d, &d + 1) == false);
+}
+
+namespace {
+    struct particle {
+        double mass;
+        int charge;
+        char tag;
+    };
+
+    // The `charged` subobject sits at a different offset in an `ion` and in
+    // a `heavy_ion`.
+    struct charged {
+        int charge;
+    };
+
+    struct ion : virtual charged {
+        double mass;
+    };
+
+    struct heavy_ion : ion {
+        double shell[3];
+    };
+}
+
+TEST_CASE("gather", "Load a field from many targets at every supported SIMD level") {
+    using base::simd_level;
+
+    std::vector<particle> particles(300);
+    for (std::size_t i = 0; i != particles.size(); ++i) {
+        particles[i] = { 0.5 * static_cast<double>(i), static_cast<int>(i) - 100, static_cast<char>('a' + i % 26) };
+    }
+    std::vector<ptr<particle const>> pointers;
+    for (auto const& p : particles) pointers.push_back(raw_ptr(&p));
+    std::shuffle(pointers.begin(), pointers.end(), std::mt19937(42));
+
+    for (auto level : { simd_level::scalar, simd_level::sse2, simd_level::avx2, simd_level::avx512 }) {
+        if (level > base::supported_simd_level()) break;
+
+        for (std::size_t n : { 0, 1, 3, 4, 7, 8, 9, 17, 300 }) {
+            auto const first = pointers.data();
+            auto const last = first + n;
+            std::vector<double> masses(n);
+            std::vector<int> charges(n);
+            std::vector<char> tags(n);
+            base::detail::gather(level, first, last, &particle::mass, masses.data(), 4);
+            base::detail::gather(level, first, last, &particle::charge, charges.data(), 4);
+            base::detail::gather(level, first, last, &particle::tag, tags.data(), 4);
+            for (std::size_t i = 0; i != n; ++i) {
+                REQUIRE(masses[i] == pointers[i]->mass);
+                REQUIRE(charges[i] == pointers[i]->charge);
+                REQUIRE(tags[i] == pointers[i]->tag);
+            }
+        }
+    }
+
+    auto const first = pointers.data();
+    auto const last = first + pointers.size();
+    REQUIRE(base::gather_sum(first, last, &particle::charge) == 300 * 299 / 2 - 300 * 100);
+    REQUIRE(base::gather_sum(first, last, &particle::mass) == 0.5 * 300 * 299 / 2);
+    auto const max_charge = base::gather_reduce(first, last, &particle::charge, 0,
+        [](int a, int b) { return std::max(a, b); });
+    REQUIRE(max_charge == 199);
+    REQUIRE(base::gather_sum(first, first, &particle::mass, 0) == 0.0);
+
+    std::vector<ion> ions(20);
+    std::vector<heavy_ion> heavy_ions(20);
+    std::vector<ptr<ion const>> ion_pointers;
+    for (std::size_t i = 0; i != ions.size(); ++i) {
+        ions[i].charge = static_cast<int>(i);
+        heavy_ions[i].charge = -static_cast<int>(i);
+        ion_pointers.push_back(raw_ptr(&ions[i]));
+        ion_pointers.push_back(raw_ptr(static_cast<ion const*>(&heavy_ions[i])));
+    }
+    for (auto level : { simd_level::scalar, simd_level::avx2, simd_level::avx512 }) {
+        if (level > base::supported_simd_level()) break;
+        std::vector<int> charges(ion_pointers.size());
+        base::detail::gather(level, ion_pointers.data(), ion_pointers.data() + ion_pointers.size(),
+            &charged::charge, charges.data(), 4);
+        for (std::size_t i = 0; i != charges.size(); ++i) REQUIRE(charges[i] == ion_pointers[i]->charge);
+    }
+}
+
+TEST_CASE("ptr_interner", "Dense IDs for pointers and bitset set algebra") {
+    std::vector<int> objects(1000);
+    base::ptr_interner<int> interner;
+    REQUIRE(interner.empty());
+    REQUIRE(interner.find(nullptr) == interner.npos);
+
+    for (std::size_t i = 0; i != objects.size(); ++i) {
+        REQUIRE(interner.intern(raw_ptr(&objects[i])) == i);
+    }
+    REQUIRE(interner.intern(nullptr) == 1000);
+    REQUIRE(interner.size() == 1001);
+    for (std::size_t i = 0; i != objects.size(); ++i) {
+        REQUIRE(interner.intern(raw_ptr(&objects[i])) == i);
+        REQUIRE(interner.find(raw_ptr(&objects[i])) == i);
+        REQUIRE(interner[static_cast<std::uint32_t>(i)] == raw_ptr(&objects[i]));
+    }
+    REQUIRE(interner.find(nullptr) == 1000);
+    int other;
+    REQUIRE(not interner.contains(raw_ptr(&other)));
+    REQUIRE(std::distance(interner.begin(), interner.end()) == 1001);
+
+    interner.clear();
+    REQUIRE(interner.empty());
+    REQUIRE(not interner.contains(raw_ptr(&objects[0])));
+    interner.reserve(100);
+    REQUIRE(interner.intern(raw_ptr(&objects[5])) == 0);
+
+    base::ptr_bitset evens;
+    base::ptr_bitset threes(10);
+    for (std::size_t id = 0; id < 200; id += 2) evens.set(id);
+    for (std::size_t id = 0; id < 150; id += 3) threes.set(id);
+    REQUIRE(evens.size() == 199);
+    REQUIRE(threes.size() == 148);
+    REQUIRE(evens.count() == 100);
+    REQUIRE(threes.count() == 50);
+    REQUIRE(evens.test(198));
+    REQUIRE(not evens.test(199));
+    REQUIRE(not evens.test(1000));
+
+    auto const both = evens & threes;
+    auto const either = evens | threes;
+    auto const only_evens = evens - threes;
+    for (std::size_t id = 0; id != 250; ++id) {
+        bool const even = id % 2 == 0 and id < 200;
+        bool const three = id % 3 == 0 and id < 150;
+        REQUIRE(both.test(id) == (even and three));
+        REQUIRE(either.test(id) == (even or three));
+        REQUIRE(only_evens.test(id) == (even and not three));
+    }
+    REQUIRE(both.count() == 25);
+    REQUIRE(either.count() == 125);
+
+    std::vector<std::size_t> ids;
+    both.for_each([&](std::size_t id) { ids.push_back(id); });
+    REQUIRE(ids.size() == both.count());
+    REQUIRE(std::is_sorted(ids.begin(), ids.end()));
+    REQUIRE(ids.front() == 0);
+    REQUIRE(ids.back() == 144);
+
+    auto shrunk = evens;
+    shrunk.resize(100);
+    REQUIRE(shrunk.count() == 50);
+    shrunk.resize(300);
+    REQUIRE(shrunk.count() == 50);
+    base::ptr_bitset low;
+    for (std::size_t id = 0; id < 100; id += 2) low.set(id);
+    REQUIRE(shrunk == low);
+    REQUIRE(shrunk != evens);
+    shrunk.reset(0);
+    shrunk.reset(1000);
+    REQUIRE(shrunk.count() == 49);
+    shrunk.clear();
+    REQUIRE(shrunk.none());
+    REQUIRE(not shrunk.any());
+    REQUIRE(shrunk == base::ptr_bitset());
+}
+
+namespace {
+    // Passes `items` through `queue` from `producers` threads to as many
+    // consumers, in batches of up to `batch`; returns the popped pointers.
+    template <typename Queue>
+    std::vector<ptr<int>> transfer(Queue& queue, std::vector<int>& items, unsigned producers, std::size_t batch) {
+        auto const n = items.size();
+        std::vector<std::vector<ptr<int>>> received(producers);
+        std::atomic<std::size_t> remaining(n);
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t != producers; ++t) {
+            threads.emplace_back([&, t] {
+                std::vector<ptr<int>> mine;
+                for (std::size_t i = t; i < n; i += producers) mine.push_back(raw_ptr(&items[i]));
+                for (auto first = mine.data(), last = first + mine.size(); first != last;) {
+                    auto const pushed = queue.push(first, std::min(last, first + batch));
+                    if (pushed == 0) std::this_thread::yield();
+                    first += pushed;
+                }
+            });
+            threads.emplace_back([&, t] {
+                std::vector<ptr<int>> buffer(batch);
+                while (remaining.load() != 0) {
+                    auto const popped = queue.pop(buffer.data(), batch);
+                    if (popped == 0) std::this_thread::yield();
+                    received[t].insert(received[t].end(), buffer.begin(), buffer.begin() + popped);
+                    remaining -= popped;
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        std::vector<ptr<int>> all;
+        for (auto const& r : received) all.insert(all.end(), r.begin(), r.end());
+        return all;
+    }
+}
+
+TEST_CASE("ptr_queue", "Bounded SPSC and MPMC queues of pointers") {
+    int objects[10];
+    std::vector<ptr<int>> pointers;
+    for (auto& object : objects) pointers.push_back(raw_ptr(&object));
+
+    base::spsc_ptr_queue<int> spsc(5);
+    REQUIRE(spsc.capacity() == 8);
+    REQUIRE(spsc.try_pop() == nullptr);
+    REQUIRE(spsc.try_push(pointers[0]));
+    REQUIRE(spsc.push(pointers.data() + 1, pointers.data() + 10) == 7);
+    REQUIRE(not spsc.try_push(pointers[9]));
+    REQUIRE(spsc.try_pop() == pointers[0]);
+    REQUIRE(spsc.try_pop() == pointers[1]);
+    // The last slot of this batch is still in use, so only a prefix fits.
+    REQUIRE(spsc.push(pointers.data() + 8, pointers.data() + 10) == 2);
+    std::vector<ptr<int>> out(10);
+    REQUIRE(spsc.pop(out.data(), 10) == 8);
+    REQUIRE(std::equal(out.begin(), out.begin() + 8, pointers.begin() + 2));
+    REQUIRE(spsc.try_pop() == nullptr);
+
+    base::mpmc_ptr_queue<int> mpmc(8);
+    REQUIRE(mpmc.capacity() == 8);
+    REQUIRE(mpmc.try_pop() == nullptr);
+    REQUIRE(mpmc.push(pointers.data(), pointers.data() + 10) == 8);
+    REQUIRE(not mpmc.try_push(pointers[8]));
+    REQUIRE(mpmc.pop(out.data(), 3) == 3);
+    REQUIRE(std::equal(out.begin(), out.begin() + 3, pointers.begin()));
+    REQUIRE(mpmc.push(pointers.data() + 8, pointers.data() + 10) == 2);
+    REQUIRE(mpmc.try_push(pointers[0]));
+    REQUIRE(mpmc.pop(out.data(), 10) == 8);
+    REQUIRE(std::equal(out.begin(), out.begin() + 7, pointers.begin() + 3));
+    REQUIRE(out[7] == pointers[0]);
+    REQUIRE(mpmc.try_pop() == nullptr);
+
+    // Null cannot be told from an empty slot, so it ends a batch.
+    std::vector<ptr<int>> with_null = { pointers[0], pointers[1], nullptr, pointers[2] };
+    REQUIRE(not spsc.try_push(nullptr));
+    REQUIRE(spsc.push(with_null.data(), with_null.data() + 4) == 2);
+    REQUIRE(spsc.push(with_null.data() + 2, with_null.data() + 4) == 0);
+    REQUIRE(spsc.pop(out.data(), 10) == 2);
+    REQUIRE(spsc.try_push(pointers[3]));
+    REQUIRE(spsc.try_pop() == pointers[3]);
+    REQUIRE(not mpmc.try_push(nullptr));
+    REQUIRE(mpmc.push(with_null.data(), with_null.data() + 4) == 2);
+    REQUIRE(mpmc.pop(out.data(), 10) == 2);
+    REQUIRE(mpmc.try_pop() == nullptr);
+
+    std::vector<int> items(20000);
+    auto expected = std::vector<ptr<int>>();
+    for (auto& item : items) expected.push_back(raw_ptr(&item));
+
+    base::spsc_ptr_queue<int> spsc_large(64);
+    auto received = transfer(spsc_large, items, 1, 16);
+    REQUIRE(received == expected);
+
+    for (unsigned producers : { 1, 4 }) {
+        base::mpmc_ptr_queue<int> mpmc_large(64);
+        received = transfer(mpmc_large, items, producers, 16);
+        std::sort(received.begin(), received.end());
+        REQUIRE(received == expected);
+    }
+}
+
+namespace {
+    // Sums a complete binary tree in parallel, one task per node.
+    struct tree_sum : base::task {
+        explicit tree_sum(ptr<tree_node const> node) : node(node), sum(0) { }
+
+        void run(base::fork_join_pool& pool) override {
+            sum = node->value;
+            tree_sum left(node->left);
+            tree_sum right(node->right);
+            if (node->left != nullptr) pool.spawn(raw_ptr(&left));
+            if (node->right != nullptr) pool.spawn(raw_ptr(&right));
+            pool.sync();
+            if (node->left != nullptr) sum += left.sum;
+            if (node->right != nullptr) sum += right.sum;
+        }
+
+        ptr<tree_node const> node;
+        long sum;
+    };
+}
+
+TEST_CASE("work_stealing", "Chase-Lev deque and fork-join pool") {
+    std::vector<int> objects(1000);
+    base::work_stealing_deque<int> deque(4);
+    REQUIRE(deque.empty());
+    REQUIRE(deque.pop() == nullptr);
+    REQUIRE(deque.steal() == nullptr);
+    for (auto& object : objects) deque.push(raw_ptr(&object));
+    REQUIRE(deque.size() == 1000);
+    REQUIRE(deque.pop() == raw_ptr(&objects[999]));
+    REQUIRE(deque.steal() == raw_ptr(&objects[0]));
+    REQUIRE(deque.steal() == raw_ptr(&objects[1]));
+    REQUIRE(deque.pop() == raw_ptr(&objects[998]));
+    while (deque.pop() != nullptr) { }
+    REQUIRE(deque.empty());
+
+    // The owner pushes and pops while thieves steal; every element must be
+    // taken exactly once.
+    std::vector<std::atomic<int>> taken(objects.size());
+    for (auto& count : taken) count.store(0);
+    auto const take = [&](ptr<int> p) { ++taken[static_cast<std::size_t>(p.get() - objects.data())]; };
+    std::atomic<bool> done(false);
+    std::vector<std::thread> thieves;
+    for (int t = 0; t != 3; ++t) {
+        thieves.emplace_back([&] {
+            while (not done.load()) {
+                auto const p = deque.steal();
+                if (p != nullptr) take(p); else std::this_thread::yield();
+            }
+        });
+    }
+    for (std::size_t i = 0; i != objects.size(); ++i) {
+        deque.push(raw_ptr(&objects[i]));
+        if (i % 3 == 0) {
+            auto const p = deque.pop();
+            if (p != nullptr) take(p);
+        }
+    }
+    for (ptr<int> p; (p = deque.pop()) != nullptr;) take(p);
+    done.store(true);
+    for (auto& thief : thieves) thief.join();
+    REQUIRE(std::all_of(taken.begin(), taken.end(), [](std::atomic<int> const& count) { return count == 1; }));
+
+    std::vector<tree_node> nodes(1023);
+    long expected = 0;
+    for (std::size_t i = 0; i != nodes.size(); ++i) {
+        nodes[i].value = static_cast<int>(i);
+        expected += static_cast<long>(i);
+        if (2 * i + 1 < nodes.size()) nodes[i].left = raw_ptr(&nodes[2 * i + 1]);
+        if (2 * i + 2 < nodes.size()) nodes[i].right = raw_ptr(&nodes[2 * i + 2]);
+    }
+    for (unsigned threads : { 1, 4 }) {
+        base::fork_join_pool pool(threads);
+        REQUIRE(pool.size() == threads);
+        tree_sum root(raw_ptr(&nodes[0]));
+        pool.run(raw_ptr(&root));
+        REQUIRE(root.sum == expected);
+        // Nothing to wait for outside a task.
+        pool.sync();
+    }
+}
+
+namespace {
+    struct pooled {
+        int value;
+        ptr<pooled> next;
+        std::atomic<ptr<pooled>> free_next;
+    };
+
+    using pooled_list = base::intrusive_slist<pooled, &pooled::next>;
+    using pooled_stack = base::lockfree_stack<pooled, &pooled::free_next>;
+
+    std::vector<int> values_of(pooled_list const& list) {
+        std::vector<int> values;
+        for (auto const& item : list) values.push_back(item.value);
+        return values;
+    }
+}
+
+TEST_CASE("intrusive_list", "Intrusive singly linked list and lock-free stack") {
+    std::vector<pooled> items(1000);
+    for (std::size_t i = 0; i != items.size(); ++i) items[i].value = static_cast<int>(i);
+    auto const item = [&](std::size_t i) { return raw_ptr(&items[i]); };
+
+    pooled_list list;
+    REQUIRE(list.empty());
+    REQUIRE(list.pop_front() == nullptr);
+    list.push_back(item(1));
+    list.push_front(item(0));
+    list.push_back(item(2));
+    REQUIRE(values_of(list) == (std::vector<int>{ 0, 1, 2 }));
+    REQUIRE(list.front() == item(0));
+    REQUIRE(list.back() == item(2));
+
+    pooled_list other;
+    other.push_back(item(3));
+    other.push_back(item(4));
+    list.splice_back(other);
+    REQUIRE(other.empty());
+    other.push_back(item(5));
+    list.splice_front(other);
+    REQUIRE(values_of(list) == (std::vector<int>{ 5, 0, 1, 2, 3, 4 }));
+    REQUIRE(list.back() == item(4));
+    REQUIRE(list.pop_front() == item(5));
+
+    pooled_list moved(std::move(list));
+    REQUIRE(list.empty());
+    REQUIRE(values_of(moved) == (std::vector<int>{ 0, 1, 2, 3, 4 }));
+    while (moved.pop_front() != nullptr) { }
+    REQUIRE(moved.back() == nullptr);
+
+    pooled_stack stack;
+    REQUIRE(stack.empty());
+    REQUIRE(stack.pop() == nullptr);
+    stack.push(item(0));
+    stack.push(item(1));
+    for (std::size_t i = 2; i != 5; ++i) moved.push_back(item(i));
+    stack.push_chain(moved);
+    REQUIRE(moved.empty());
+    REQUIRE(stack.pop() == item(2));
+    REQUIRE(stack.pop() == item(3));
+    REQUIRE(stack.pop() == item(4));
+    REQUIRE(stack.pop() == item(1));
+    auto chain = stack.pop_all();
+    REQUIRE(chain == item(0));
+    REQUIRE(chain->free_next.load() == nullptr);
+    REQUIRE(stack.empty());
+
+    // Threads pop, then push back in chains of two; every element must still
+    // be on the stack exactly once at the end.
+    for (auto& i : items) stack.push(raw_ptr(&i));
+    std::vector<std::thread> threads;
+    for (int t = 0; t != 4; ++t) {
+        threads.emplace_back([&] {
+            for (int round = 0; round != 2000; ++round) {
+                auto const a = stack.pop();
+                auto const b = stack.pop();
+                if (a != nullptr and b != nullptr) {
+                    a->free_next.store(b);
+                    stack.push_chain(a, b);
+                } else {
+                    if (a != nullptr) stack.push(a);
+                    if (b != nullptr) stack.push(b);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    std::vector<ptr<pooled>> popped;
+    for (auto p = stack.pop_all(); p != nullptr; p = p->free_next.load()) popped.push_back(p);
+    std::sort(popped.begin(), popped.end());
+    REQUIRE(popped.size() == items.size());
+    REQUIRE(std::adjacent_find(popped.begin(), popped.end()) == popped.end());
+}
+
+namespace {
+    struct graph_node {
+        std::vector<ptr<graph_node>> edges;
+        std::atomic<std::size_t> depth;
+        std::atomic<int> visits;
+    };
+
+    struct graph_edges {
+        template <typename F>
+        void operator ()(ptr<graph_node> node, F&& f) const {
+            for (auto target : node->edges) f(target);
+        }
+    };
+}
+
+TEST_CASE("graph_traversal", "Parallel BFS and sequential DFS over ptr edges") {
+    // Node i links to 2i + 1, 2i + 2 and back to i / 3, plus a null edge.
+    std::vector<graph_node> nodes(5000);
+    for (std::size_t i = 0; i != nodes.size(); ++i) {
+        for (auto j : { 2 * i + 1, 2 * i + 2, i / 3 }) {
+            if (j < nodes.size()) nodes[i].edges.push_back(raw_ptr(&nodes[j]));
+        }
+        nodes[i].edges.push_back(nullptr);
+    }
+    auto const root = raw_ptr(&nodes[0]);
+    auto const expected_depth = [](std::size_t i) {
+        std::size_t depth = 0;
+        for (; i != 0; i = (i - 1) / 2) ++depth;
+        return depth;
+    };
+
+    for (unsigned threads : { 1, 4 }) {
+        base::fork_join_pool pool(threads);
+        for (auto& node : nodes) node.visits = 0;
+        auto const result = base::breadth_first(pool, root, graph_edges(),
+            [](ptr<graph_node> node, std::size_t depth) {
+                node->depth = depth;
+                ++node->visits;
+                return true;
+            });
+        REQUIRE(result.visited == nodes.size());
+        REQUIRE(not result.stopped);
+        for (std::size_t i = 0; i != nodes.size(); ++i) {
+            REQUIRE(nodes[i].visits.load() == 1);
+            REQUIRE(nodes[i].depth.load() == expected_depth(i));
+        }
+
+        std::atomic<std::size_t> seen(0);
+        auto const stopped = base::breadth_first(pool, root, graph_edges(),
+            [&](ptr<graph_node>, std::size_t depth) { ++seen; return depth < 5; });
+        REQUIRE(stopped.stopped);
+        REQUIRE(stopped.visited == seen.load());
+        REQUIRE(stopped.visited > 31);
+        REQUIRE(stopped.visited < nodes.size());
+    }
+
+    std::vector<std::size_t> order;
+    auto const dfs = base::depth_first(root, graph_edges(), [&](ptr<graph_node> node, std::size_t) {
+        order.push_back(static_cast<std::size_t>(node.get() - nodes.data()));
+        return true;
+    });
+    REQUIRE(dfs.visited == nodes.size());
+    REQUIRE((std::vector<std::size_t>(order.begin(), order.begin() + 4) == std::vector<std::size_t>{ 0, 1, 3, 7 }));
+    std::sort(order.begin(), order.end());
+    REQUIRE(std::adjacent_find(order.begin(), order.end()) == order.end());
+
+    auto const limited = base::depth_first(root, graph_edges(),
+        [](ptr<graph_node>, std::size_t depth) { return depth < 3; });
+    REQUIRE(limited.stopped);
+    REQUIRE(limited.visited == 4);
+
+    tree_node tree[3] = { };
+    tree[0].left = raw_ptr(&tree[1]);
+    tree[0].right = raw_ptr(&tree[2]);
+    tree[2].left = raw_ptr(&tree[0]);
+    std::vector<ptr<tree_node>> visited;
+    base::depth_first(raw_ptr(&tree[0]), base::ptr_field_edges<tree_node>(),
+        [&](ptr<tree_node> node, std::size_t) { visited.push_back(node); return true; });
+    REQUIRE((visited == std::vector<ptr<tree_node>>{ raw_ptr(&tree[0]), raw_ptr(&tree[1]), raw_ptr(&tree[2]) }));
+    REQUIRE(base::depth_first(ptr<tree_node>(nullptr), base::ptr_field_edges<tree_node>(),
+        [](ptr<tree_node>, std::size_t) { return true; }).visited == 0);
+}
+
+namespace {
+    // Complete binary tree of `n` nodes with values 0 ... n - 1 in breadth-
+    // first order, scattered over `storage` in random order.
+    ptr<tree_node> scattered_tree(std::vector<tree_node>& storage, std::size_t n) {
+        storage.assign(n, tree_node());
+        std::vector<std::size_t> slots(n);
+        for (std::size_t i = 0; i != n; ++i) slots[i] = i;
+        std::shuffle(slots.begin(), slots.end(), std::mt19937(7));
+        auto const at = [&](std::size_t i) { return raw_ptr(&storage[slots[i]]); };
+        for (std::size_t i = 0; i != n; ++i) {
+            at(i)->value = static_cast<int>(i);
+            if (2 * i + 1 < n) at(i)->left = at(2 * i + 1);
+            if (2 * i + 2 < n) at(i)->right = at(2 * i + 2);
+        }
+        return n == 0 ? nullptr : at(0);
+    }
+
+    // Whether `node` is the root of the tree built by `scattered_tree`.
+    bool is_tree(ptr<tree_node> node, std::size_t n, std::size_t i = 0) {
+        if (i >= n) return node == nullptr;
+        return node != nullptr and node->value == static_cast<int>(i) and
+            is_tree(node->left, n, 2 * i + 1) and is_tree(node->right, n, 2 * i + 2);
+    }
+}
+
+TEST_CASE("compact", "Relocate reachable nodes into a contiguous arena") {
+    std::vector<tree_node> storage;
+    auto root = scattered_tree(storage, 100);
+    auto const old_root = root;
+    auto arena = base::compact(root);
+    REQUIRE(arena.size() == 100);
+    REQUIRE(root == raw_ptr(&arena[0]));
+    REQUIRE(is_tree(root, 100));
+    for (std::size_t i = 0; i != arena.size(); ++i) REQUIRE(arena[i].value == static_cast<int>(i));
+    REQUIRE(is_tree(old_root, 100));
+
+    // Shared and cyclic links are copied once; unreachable nodes are dropped.
+    tree_node extra[4] = { };
+    extra[0].left = raw_ptr(&extra[1]);
+    extra[0].right = raw_ptr(&extra[1]);
+    extra[1].left = raw_ptr(&extra[0]);
+    extra[2].left = raw_ptr(&extra[1]);
+    ptr<tree_node> roots[] = { raw_ptr(&extra[0]), nullptr, raw_ptr(&extra[1]) };
+    auto const small = base::compact(roots, roots + 3);
+    REQUIRE(small.size() == 2);
+    REQUIRE(roots[0] == raw_ptr(&small[0]));
+    REQUIRE(roots[1] == nullptr);
+    REQUIRE(roots[2] == raw_ptr(&small[1]));
+    REQUIRE(small[0].left == roots[2]);
+    REQUIRE(small[0].right == roots[2]);
+    REQUIRE(small[1].left == roots[0]);
+    REQUIRE(small[1].right == nullptr);
+
+    ptr<tree_node> none = nullptr;
+    REQUIRE(base::compact(none).empty());
+}
+
+TEST_CASE("relayout", "Reorder a tree in BFS, DFS and van Emde Boas order") {
+    using base::layout_order;
+
+    // Positions of the nodes of a complete tree of height 4, by value.
+    auto const positions = [](std::vector<tree_node> const& arena) {
+        std::vector<int> values;
+        for (auto const& node : arena) values.push_back(node.value);
+        return values;
+    };
+
+    std::vector<tree_node> storage;
+    auto root = scattered_tree(storage, 15);
+    auto bfs = base::relayout(root, layout_order::breadth_first);
+    REQUIRE(is_tree(root, 15));
+    REQUIRE(root == raw_ptr(&bfs[0]));
+    REQUIRE(positions(bfs) == (std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14 }));
+
+    auto dfs = base::relayout(root, base::ptr_fields<tree_node>(), layout_order::depth_first);
+    REQUIRE(is_tree(root, 15));
+    REQUIRE(root == raw_ptr(&dfs[0]));
+    REQUIRE(positions(dfs) == (std::vector<int>{ 0, 1, 3, 7, 8, 4, 9, 10, 2, 5, 11, 12, 6, 13, 14 }));
+
+    // Top two levels, then the four subtrees of height two.
+    auto veb = base::relayout(root, layout_order::van_emde_boas);
+    REQUIRE(is_tree(root, 15));
+    REQUIRE(root == raw_ptr(&veb[0]));
+    REQUIRE(positions(veb) == (std::vector<int>{ 0, 1, 2, 3, 7, 8, 4, 9, 10, 5, 11, 12, 6, 13, 14 }));
+
+    for (auto order : { layout_order::breadth_first, layout_order::depth_first, layout_order::van_emde_boas }) {
+        root = scattered_tree(storage, 1000);
+        auto const arena = base::relayout(root, order);
+        REQUIRE(arena.size() == 1000);
+        REQUIRE(is_tree(root, 1000));
+
+        // A cycle is not a tree, but every node must still be placed.
+        tree_node cycle[3] = { };
+        cycle[0].left = raw_ptr(&cycle[1]);
+        cycle[1].left = raw_ptr(&cycle[2]);
+        cycle[2].left = raw_ptr(&cycle[0]);
+        cycle[0].right = raw_ptr(&cycle[2]);
+        auto cycle_root = raw_ptr(&cycle[0]);
+        auto const relaid = base::relayout(cycle_root, order);
+        REQUIRE(relaid.size() == 3);
+        REQUIRE(cycle_root->left->left->left == cycle_root);
+
+        // A ladder of shared children: the number of paths doubles at every
+        // level, but every node must be placed once, in reasonable time.
+        std::vector<tree_node> ladder(64);
+        for (std::size_t i = 0; i != ladder.size(); ++i) {
+            ladder[i].value = static_cast<int>(i);
+            if (i + 2 >= ladder.size()) continue;
+            ladder[i].left = raw_ptr(&ladder[i - i % 2 + 2]);
+            ladder[i].right = raw_ptr(&ladder[i - i % 2 + 3]);
+        }
+        auto ladder_root = raw_ptr(&ladder[0]);
+        auto const ladder_arena = base::relayout(ladder_root, order);
+        REQUIRE(ladder_arena.size() == 63);
+        auto rung = ladder_root;
+        for (int level = 0; level != 31; ++level) {
+            REQUIRE(rung->left->value == 2 * level + 2);
+            REQUIRE(rung->right->value == 2 * level + 3);
+            REQUIRE(rung->left->right == rung->right->right);
+            rung = rung->right;
+        }
+
+        ptr<tree_node> none = nullptr;
+        REQUIRE(base::relayout(none, order).empty());
+    }
+}
+
+TEST_CASE("packed_ptr_array", "Pointers stored in six bytes each") {
+    using base::simd_level;
+
+    std::vector<int> objects(300);
+    std::vector<ptr<int>> pointers;
+    for (auto& object : objects) pointers.push_back(raw_ptr(&object));
+    std::shuffle(pointers.begin(), pointers.end(), std::mt19937(42));
+    pointers[7] = nullptr;
+    int local;
+    pointers[8] = raw_ptr(&local);
+
+    {
+        base::packed_ptr_array<int> array;
+        REQUIRE(array.empty());
+        for (auto p : pointers) array.push_back(p);
+        REQUIRE(array.size() == 300);
+        REQUIRE(array.front() == pointers.front());
+        REQUIRE(array.back() == pointers.back());
+        for (std::size_t i = 0; i != pointers.size(); ++i) REQUIRE(array[i] == pointers[i]);
+        REQUIRE(array[7] == nullptr);
+
+        array[0] = array[8];
+        *array[1] = 42;
+        REQUIRE(array[0] == raw_ptr(&local));
+        REQUIRE(*pointers[1] == 42);
+
+        array.pop_back();
+        array.resize(301);
+        REQUIRE(array.size() == 301);
+        REQUIRE(array[299] == nullptr);
+        REQUIRE(array[300] == nullptr);
+
+        base::packed_ptr_array<int> const filled(3, pointers[2]);
+        REQUIRE(filled[0] == pointers[2]);
+        REQUIRE(filled[2] == pointers[2]);
+        REQUIRE(base::packed_ptr_array<int>(2) == base::packed_ptr_array<int>({ nullptr, nullptr }));
+        REQUIRE(filled != base::packed_ptr_array<int>(3));
+    }
+
+    // Proxy iterators work with the standard algorithms.
+    {
+        base::packed_ptr_array<int> array(pointers.begin(), pointers.end());
+        auto const& const_array = array;
+        REQUIRE(std::equal(const_array.begin(), const_array.end(), pointers.begin()));
+        REQUIRE(std::distance(array.begin(), array.end()) == 300);
+        REQUIRE(array.begin()[5] == pointers[5]);
+        REQUIRE(*(array.end() - 1) == pointers.back());
+        base::packed_ptr_array<int>::const_iterator i = array.begin();
+        REQUIRE(i == const_array.begin());
+        REQUIRE(i < const_array.end());
+
+        std::sort(array.begin(), array.end());
+        std::sort(pointers.begin(), pointers.end());
+        REQUIRE(std::equal(array.begin(), array.end(), pointers.begin()));
+        std::reverse(array.begin(), array.end());
+        REQUIRE(array.front() == pointers.back());
+        REQUIRE(std::find(array.begin(), array.end(), raw_ptr(&local)) != array.end());
+    }
+
+    {
+        for (auto level : { simd_level::scalar, simd_level::sse2, simd_level::avx2, simd_level::avx512 }) {
+            if (level > base::supported_simd_level()) break;
+
+            for (std::size_t n : { 0, 1, 3, 4, 5, 8, 9, 17, 300 }) {
+                std::vector<unsigned char> bytes(6 * n);
+                base::detail::pack(level, pointers.data(), pointers.data() + n, bytes.data());
+                for (std::size_t i = 0; i != n; ++i) {
+                    REQUIRE(base::detail::unpack_ptr<int>(&bytes[6 * i]) == pointers[i]);
+                }
+                std::vector<ptr<int>> out(n);
+                base::detail::unpack(level, bytes.data(), n, bytes.size(), out.data());
+                REQUIRE(out == std::vector<ptr<int>>(pointers.begin(), pointers.begin() + n));
+            }
+        }
+
+        base::packed_ptr_array<int> array(pointers.data(), pointers.data() + pointers.size());
+        REQUIRE(std::equal(array.begin(), array.end(), pointers.begin()));
+        std::vector<ptr<int>> out(100);
+        array.unpack(200, 100, out.data());
+        REQUIRE(std::equal(out.begin(), out.end(), pointers.begin() + 200));
+        array.pack(10, pointers.data(), pointers.data() + 20);
+        REQUIRE(std::equal(array.begin() + 10, array.begin() + 30, pointers.begin()));
+        REQUIRE(array[9] == pointers[9]);
+        REQUIRE(array[30] == pointers[30]);
+    }
+
+    {
+        // Canonical addresses in the upper half come back sign-extended;
+        // wider ones do not fit.
+        auto const from_word = [](std::uint64_t word) {
+            return raw_ptr(reinterpret_cast<int*>(static_cast<std::uintptr_t>(word)));
+        };
+        std::vector<ptr<int>> high;
+        for (std::uint64_t i = 0; i != 12; ++i) {
+            high.push_back(from_word(i % 2 ? 0xffff800000000000 + 8 * i : 0x00007ffffffffff0 - 8 * i));
+        }
+        for (auto level : { simd_level::scalar, simd_level::avx2 }) {
+            if (level > base::supported_simd_level()) break;
+            std::vector<unsigned char> bytes(6 * high.size());
+            base::detail::pack(level, high.data(), high.data() + high.size(), bytes.data());
+            std::vector<ptr<int>> out(high.size());
+            base::detail::unpack(level, bytes.data(), high.size(), bytes.size(), out.data());
+            REQUIRE(out == high);
+        }
+        REQUIRE(base::detail::packable(from_word(0xffff800000000000)));
+        REQUIRE(not base::detail::packable(from_word(0x0000800000000000)));
+        REQUIRE(not base::detail::packable(from_word(0x00ff7f0000000000)));
+        REQUIRE(not base::detail::packable(from_word(0x8000000000001000)));
+    }
+}
@@ -0,0 +1,26 @@
+// Decodes a trace file written by `base::binary_writer`, printing one line
+// per record: its index, tag and value in hex.
+
+#include <cinttypes>
+#include <cstdio>
+#include <exception>
+
+#include "binary_trace.hpp"
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s trace-file\n", argv[0]);
+        return 2;
+    }
+
+    try {
+        base::binary_reader const reader(argv[1]);
+        std::size_t index = 0;
+        for (auto const& record : reader) {
+            std::printf("%zu\t%" PRIu64 "\t0x%016" PRIx64 "\n", index++, record.tag, record.value);
+        }
+    } catch (std::exception const& error) {
+        std::fprintf(stderr, "%s: %s\n", argv[0], error.what());
+        return 1;
+    }
+}
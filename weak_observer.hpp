@@ -0,0 +1,165 @@
+#ifndef BASE_WEAK_OBSERVER_HPP
+#define BASE_WEAK_OBSERVER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include "ptr.hpp"
+
+namespace base {
+
+// Policies for `observable`. `single_threaded` uses a plain generation word;
+// `sequence_locked` uses an atomic one that follows the sequence lock
+// protocol: the generation is odd while an invalidation is in progress.
+struct single_threaded { };
+struct sequence_locked { };
+
+using generation_t = std::uint32_t;
+
+// Intrusive control word for objects that can be observed through a
+// `weak_observer`. Derive from it and call `invalidate()` whenever the object
+// dies or its slot is recycled. Since observers read the control word, the
+// object's storage must outlive them (e.g. pooled or arena-allocated cache
+// entries); `invalidate()` only marks the *logical* end of life.
+//
+// The generation must keep counting across all objects that occupy the same
+// storage, or observers of an earlier occupant could lock a later one. Either
+// reuse the storage by assignment, which leaves the generation alone, or end
+// the object with `retire()` and construct its successor with the returned
+// generation. The default and copy constructors start from generation 0 and
+// are only for storage no observer has seen. Observers must not be used
+// while no object lives in the storage.
+template <typename Policy = single_threaded>
+class observable;
+
+template <>
+class observable<single_threaded> {
+public:
+    generation_t generation() const noexcept { return gen; }
+
+    bool is_current(generation_t g) const noexcept { return gen == g; }
+
+    void invalidate() noexcept { gen += 2; }
+
+    // Invalidates and returns the generation for the next object in this
+    // storage.
+    generation_t retire() noexcept {
+        invalidate();
+        return gen;
+    }
+
+protected:
+    constexpr observable() noexcept : gen() { }
+
+    // Continues from the generation `retire()` returned for the previous
+    // object in this storage.
+    constexpr explicit observable(generation_t retired) noexcept : gen(retired) { }
+
+    // Copying an object yields a distinct identity; observers of the source
+    // must not be able to lock the copy (or vice versa).
+    observable(observable const&) noexcept : gen() { }
+
+    observable& operator =(observable const&) noexcept { return *this; }
+
+private:
+    generation_t gen;
+};
+
+template <>
+class observable<sequence_locked> {
+public:
+    generation_t generation() const noexcept {
+        return gen.load(std::memory_order_acquire);
+    }
+
+    bool is_current(generation_t g) const noexcept {
+        return gen.load(std::memory_order_acquire) == g and g % 2 == 0;
+    }
+
+    // Read-side validation of the sequence lock: after reading through a
+    // locked pointer, this tells whether the reads saw a consistent object.
+    bool still_current(generation_t g) const noexcept {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return gen.load(std::memory_order_relaxed) == g and g % 2 == 0;
+    }
+
+    // Writer side. Only one thread may invalidate a given object at a time.
+    void begin_invalidate() noexcept {
+        auto const g = gen.load(std::memory_order_relaxed);
+        gen.store(g + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void end_invalidate() noexcept {
+        auto const g = gen.load(std::memory_order_relaxed);
+        gen.store(g + 1, std::memory_order_release);
+    }
+
+    void invalidate() noexcept {
+        begin_invalidate();
+        end_invalidate();
+    }
+
+    generation_t retire() noexcept {
+        invalidate();
+        return gen.load(std::memory_order_relaxed);
+    }
+
+protected:
+    observable() noexcept : gen(0) { }
+
+    explicit observable(generation_t retired) noexcept : gen(retired) { }
+
+    observable(observable const&) noexcept : gen(0) { }
+
+    observable& operator =(observable const&) noexcept { return *this; }
+
+private:
+    std::atomic<generation_t> gen;
+};
+
+namespace detail {
+    // With a single thread, nothing can change between `lock()` and the reads
+    // through the pointer.
+    inline bool still_current(observable<single_threaded> const& target, generation_t g) noexcept {
+        return target.is_current(g);
+    }
+
+    inline bool still_current(observable<sequence_locked> const& target, generation_t g) noexcept {
+        return target.still_current(g);
+    }
+} // namespace detail
+
+// Non-owning observer of an `observable` object. Unlike `std::weak_ptr`,
+// `lock()` involves no reference counting: it is one load and one compare.
+// In `sequence_locked` mode, readers should confirm with `validate()` after
+// using the locked pointer, and discard what they read if it fails.
+template <typename T>
+class weak_observer {
+public:
+    constexpr weak_observer() noexcept : target(nullptr), gen() { }
+
+    constexpr weak_observer(std::nullptr_t) noexcept : target(nullptr), gen() { }
+
+    weak_observer(ptr<T> p) noexcept
+        : target(p), gen(p != nullptr ? p->generation() : generation_t()) { }
+
+    ptr<T> lock() const noexcept {
+        return target != nullptr and target->is_current(gen) ? target : nullptr;
+    }
+
+    bool expired() const noexcept { return lock() == nullptr; }
+
+    bool validate() const noexcept {
+        return target != nullptr and detail::still_current(*target, gen);
+    }
+
+    void reset() noexcept { *this = nullptr; }
+
+private:
+    ptr<T> target;
+    generation_t gen;
+};
+
+} // namespace base
+
+#endif // ndef BASE_WEAK_OBSERVER_HPP
@@ -0,0 +1,317 @@
+#ifndef BASE_WORK_STEALING_HPP
+#define BASE_WORK_STEALING_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "ptr.hpp"
+#include "ptr_queue.hpp"
+
+namespace base {
+
+// Chase-Lev work-stealing deque of non-null `ptr<T>`, with the memory orders
+// of Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models"
+// (PPoPP 2013). The owning thread pushes and pops at the bottom; any thread
+// may steal from the top. The buffer grows when full; old buffers are kept
+// until destruction, since thieves may still be reading them.
+template <typename T>
+class work_stealing_deque {
+public:
+    explicit work_stealing_deque(std::size_t capacity = 64) {
+        buffers.emplace_back(new buffer(detail::queue_capacity(capacity)));
+        current.store(buffers.back().get(), std::memory_order_relaxed);
+        top.value.store(0, std::memory_order_relaxed);
+        bottom.value.store(0, std::memory_order_relaxed);
+    }
+
+    work_stealing_deque(work_stealing_deque const&) = delete;
+    work_stealing_deque& operator =(work_stealing_deque const&) = delete;
+
+    // Owner only.
+    void push(ptr<T> p) {
+        auto const b = bottom.value.load(std::memory_order_relaxed);
+        auto const t = top.value.load(std::memory_order_acquire);
+        auto a = current.load(std::memory_order_relaxed);
+        if (b - t > static_cast<std::int64_t>(a->mask)) a = grow(a, t, b);
+        a->put(b, p.get());
+        // A release store rather than the paper's release fence and relaxed
+        // store: equivalent for thieves, and understood by ThreadSanitizer.
+        bottom.value.store(b + 1, std::memory_order_release);
+    }
+
+    // Owner only. Returns the most recently pushed element, or `nullptr` if
+    // the deque is empty.
+    ptr<T> pop() noexcept {
+        auto const b = bottom.value.load(std::memory_order_relaxed) - 1;
+        auto const a = current.load(std::memory_order_relaxed);
+        bottom.value.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top.value.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.value.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* p = a->get(b);
+        if (t == b) {
+            // Last element: race the thieves for it.
+            if (not top.value.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                p = nullptr;
+            }
+            bottom.value.store(b + 1, std::memory_order_relaxed);
+        }
+        return raw_ptr(p);
+    }
+
+    // Any thread. Returns the oldest element, or `nullptr` if the deque is
+    // empty or another thread took that element first.
+    ptr<T> steal() noexcept {
+        auto t = top.value.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto const b = bottom.value.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        T* const p = current.load(std::memory_order_acquire)->get(t);
+        if (not top.value.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return raw_ptr(p);
+    }
+
+    // Approximate when other threads are pushing or stealing.
+    std::size_t size() const noexcept {
+        auto const b = bottom.value.load(std::memory_order_relaxed);
+        auto const t = top.value.load(std::memory_order_relaxed);
+        return b > t ? static_cast<std::size_t>(b - t) : 0;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+private:
+    struct buffer {
+        explicit buffer(std::size_t capacity) : mask(capacity - 1), slots(new std::atomic<T*>[capacity]) { }
+
+        T* get(std::int64_t i) const noexcept {
+            return slots[static_cast<std::size_t>(i) & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(std::int64_t i, T* p) noexcept {
+            slots[static_cast<std::size_t>(i) & mask].store(p, std::memory_order_relaxed);
+        }
+
+        std::size_t const mask;
+        std::unique_ptr<std::atomic<T*>[]> slots;
+    };
+
+    buffer* grow(buffer* old, std::int64_t t, std::int64_t b) {
+        buffers.emplace_back(new buffer(2 * (old->mask + 1)));
+        auto const a = buffers.back().get();
+        for (auto i = t; i != b; ++i) a->put(i, old->get(i));
+        current.store(a, std::memory_order_release);
+        return a;
+    }
+
+    char leading_padding[detail::cache_line];
+    detail::padded<std::atomic<std::int64_t>> top;
+    detail::padded<std::atomic<std::int64_t>> bottom;
+    std::atomic<buffer*> current;
+    std::vector<std::unique_ptr<buffer>> buffers;
+};
+
+class fork_join_pool;
+
+// Unit of work for a `fork_join_pool`. Tasks are owned by the caller (for
+// instance on the stack of the task that spawns them, or in an arena) and
+// must outlive their execution; the pool only holds `ptr<task>`.
+class task {
+public:
+    task(task const&) = delete;
+    task& operator =(task const&) = delete;
+
+    // Called once on some worker thread. May spawn child tasks and `sync`.
+    virtual void run(fork_join_pool& pool) = 0;
+
+protected:
+    task() noexcept : pending(0) { }
+    ~task() = default;
+
+private:
+    friend class fork_join_pool;
+
+    ptr<task> parent = nullptr;
+    // Spawned children that have not finished yet.
+    std::atomic<std::size_t> pending;
+};
+
+// Fork-join scheduler: each worker thread owns a `work_stealing_deque` of
+// tasks, runs the tasks it spawns most-recent-first (depth first, keeping
+// data hot in its caches), and steals the oldest tasks of a random other
+// worker when idle. Tasks submitted from outside go through an injection
+// queue.
+class fork_join_pool {
+public:
+    explicit fork_join_pool(unsigned threads = std::thread::hardware_concurrency())
+        : injected(injection_capacity) {
+        if (threads == 0) threads = 1;
+        workers.reserve(threads);
+        for (unsigned i = 0; i != threads; ++i) workers.emplace_back(new worker(*this, i));
+        try {
+            for (auto& w : workers) {
+                auto const self = w.get();
+                w->thread = std::thread([this, self] { work(*self); });
+            }
+        } catch (...) {
+            // Joinable threads would call `std::terminate` when destroyed.
+            stop();
+            throw;
+        }
+    }
+
+    fork_join_pool(fork_join_pool const&) = delete;
+    fork_join_pool& operator =(fork_join_pool const&) = delete;
+
+    // Waits for the workers to finish their current tasks; tasks still queued
+    // are not run.
+    ~fork_join_pool() { stop(); }
+
+    std::size_t size() const noexcept { return workers.size(); }
+
+    // Schedules `child` as a child of the task running on the calling
+    // thread, which has to `sync` before it returns.
+    void spawn(ptr<task> child) {
+        auto const self = this_worker();
+        child->parent = self != nullptr ? self->running : nullptr;
+        if (child->parent != nullptr) child->parent->pending.fetch_add(1, std::memory_order_relaxed);
+        if (self != nullptr) {
+            self->tasks.push(child);
+        } else {
+            while (not injected.try_push(child)) std::this_thread::yield();
+        }
+    }
+
+    // Waits until all children spawned by the running task have finished,
+    // running other tasks in the meantime. Meant for `task::run`; outside
+    // the pool there are no children to wait for, and it returns at once.
+    void sync() {
+        auto const self = this_worker();
+        if (self == nullptr) return;
+        auto const running = self->running;
+        while (running->pending.load(std::memory_order_acquire) != 0) {
+            auto const t = find_task(*self);
+            if (t != nullptr) {
+                execute(*self, t);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Runs `root` and everything it spawns; returns when they have finished.
+    // Called from outside the pool, the calling thread only waits.
+    void run(ptr<task> root) {
+        if (this_worker() != nullptr) {
+            spawn(root);
+            sync();
+            return;
+        }
+        join_task join;
+        root->parent = raw_ptr(&join);
+        join.pending.store(1, std::memory_order_relaxed);
+        while (not injected.try_push(root)) std::this_thread::yield();
+        while (join.pending.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+    }
+
+private:
+    static constexpr std::size_t injection_capacity = 1024;
+
+    struct worker {
+        worker(fork_join_pool& pool, unsigned index) : pool(pool), random(index * 2 + 1) { }
+
+        fork_join_pool& pool;
+        work_stealing_deque<task> tasks;
+        ptr<task> running = nullptr;
+        std::uint32_t random;
+        std::thread thread;
+    };
+
+    // Only counts down the children of `run` called from outside the pool.
+    struct join_task : task {
+        void run(fork_join_pool&) override { }
+    };
+
+    // The worker of this pool that is the calling thread, if any.
+    worker* this_worker() const noexcept {
+        auto const w = current_worker();
+        return w != nullptr and &w->pool == this ? w : nullptr;
+    }
+
+    static worker*& current_worker() noexcept {
+        static thread_local worker* w = nullptr;
+        return w;
+    }
+
+    void stop() noexcept {
+        stopping.store(true, std::memory_order_relaxed);
+        for (auto& w : workers) {
+            if (w->thread.joinable()) w->thread.join();
+        }
+    }
+
+    void work(worker& self) {
+        current_worker() = &self;
+        unsigned idle = 0;
+        while (not stopping.load(std::memory_order_relaxed)) {
+            auto const t = find_task(self);
+            if (t != nullptr) {
+                execute(self, t);
+                idle = 0;
+            } else if (++idle < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        current_worker() = nullptr;
+    }
+
+    ptr<task> find_task(worker& self) noexcept {
+        auto t = self.tasks.pop();
+        if (t == nullptr) t = injected.try_pop();
+        auto const n = workers.size();
+        if (t != nullptr or n == 1) return t;
+        // xorshift32: a cheap random start for the round of victims.
+        self.random ^= self.random << 13;
+        self.random ^= self.random >> 17;
+        self.random ^= self.random << 5;
+        auto const start = self.random % n;
+        for (std::size_t i = 0; i != n; ++i) {
+            auto& victim = *workers[(start + i) % n];
+            if (&victim == &self) continue;
+            t = victim.tasks.steal();
+            if (t != nullptr) return t;
+        }
+        return nullptr;
+    }
+
+    void execute(worker& self, ptr<task> t) {
+        auto const outer = self.running;
+        self.running = t;
+        t->run(*this);
+        self.running = outer;
+        // `t` may be gone once its parent sees the count drop.
+        auto const parent = t->parent;
+        if (parent != nullptr) parent->pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    std::vector<std::unique_ptr<worker>> workers;
+    mpmc_ptr_queue<task> injected;
+    std::atomic<bool> stopping{false};
+};
+
+} // namespace base
+
+#endif // ndef BASE_WORK_STEALING_HPP